@@ -0,0 +1,115 @@
+// Host benchmark of the word-at-a-time delimiter scan
+// Copyright (c) B. Mourit <bnmguy@gmail.com
+// All rights reserved.
+
+// Runs on the build machine, not the target:
+//   g++ -std=gnu++20 -O2 -ISource/COMMON Examples/ByteScan_Host/main.cpp -o bytescan && ./bytescan
+// The host build takes the portable SWAR path of find_byte(); the target
+// uses UADD8/SEL, which gives the same results.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ByteScan.hpp"
+
+constexpr size_t BUFFER_SIZE = 4096;
+constexpr size_t ITERATIONS = 20000;
+constexpr uint8_t DELIMITER = '\n';
+
+static size_t find_byte_naive(std::span<const uint8_t> data, uint8_t value) {
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (data[i] == value) {
+            return i;
+        }
+    }
+    return data.size();
+}
+
+// Every offset, length and match position against the naive loop
+static bool verify() {
+    uint8_t buffer[64];
+    for (size_t start = 0; start < 8; ++start) {
+        for (size_t length = 0; length + start <= sizeof(buffer); ++length) {
+            for (size_t match = 0; match <= length; ++match) {
+                for (size_t i = 0; i < sizeof(buffer); ++i) {
+                    buffer[i] = static_cast<uint8_t>((i * 37U) | 0x80U);
+                }
+                if (match < length) {
+                    buffer[start + match] = DELIMITER;
+                    // A byte one above the delimiter trips a sloppy SWAR test
+                    if (match + 1 < length) {
+                        buffer[start + match + 1] = DELIMITER + 1;
+                    }
+                }
+                const std::span<const uint8_t> data(buffer + start, length);
+                if (find_byte(data, DELIMITER) != find_byte_naive(data, DELIMITER)) {
+                    printf("mismatch: start %zu length %zu match %zu\n", start, length, match);
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Wraparound: delimiter placed on both sides of the storage end
+    uint8_t storage[16];
+    for (size_t fill = 0; fill < sizeof(storage); ++fill) {
+        for (size_t position = 0; position < sizeof(storage); ++position) {
+            Ring_Buffer<uint8_t> ring(storage);
+            uint8_t scratch[16];
+            ring.write(std::span<const uint8_t>(scratch, fill));
+            ring.read(std::span<uint8_t>(scratch, fill));
+            for (size_t i = 0; i < sizeof(storage); ++i) {
+                ring.push((i == position) ? DELIMITER : 'a');
+            }
+            size_t offset = 0;
+            if (!find_byte(ring, DELIMITER, offset) || (offset != position)) {
+                printf("ring mismatch: fill %zu position %zu\n", fill, position);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Finder>
+static double run(const std::vector<uint8_t>& data, Finder finder, size_t& found) {
+    const auto start = std::chrono::steady_clock::now();
+    found = 0;
+    for (size_t iteration = 0; iteration < ITERATIONS; ++iteration) {
+        std::span<const uint8_t> remaining(data);
+        while (!remaining.empty()) {
+            const size_t index = finder(remaining, DELIMITER);
+            if (index == remaining.size()) {
+                break;
+            }
+            ++found;
+            remaining = remaining.subspan(index + 1);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (static_cast<double>(data.size()) * ITERATIONS) / elapsed.count() / 1e6;
+}
+
+int main() {
+    if (!verify()) {
+        return EXIT_FAILURE;
+    }
+
+    // NMEA-like traffic: an 80 byte sentence per line
+    std::vector<uint8_t> data(BUFFER_SIZE);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = ((i % 80) == 79) ? DELIMITER : static_cast<uint8_t>('0' + (i % 43));
+    }
+
+    size_t naive_found;
+    size_t swar_found;
+    const double naive = run(data, find_byte_naive, naive_found);
+    const double swar = run(data, static_cast<size_t (*)(std::span<const uint8_t>, uint8_t)>(find_byte), swar_found);
+
+    printf("naive: %8.1f MB/s\n", naive);
+    printf("word:  %8.1f MB/s (%.2fx)\n", swar, swar / naive);
+    return (naive_found == swar_found) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -16,6 +16,7 @@
 #include "PMU.hpp"
 #include "USART.hpp"
 #include "DMA.hpp"
+#include "USART_Retarget.hpp"
 
 static void handle_error(const char* error_message);
 static usart::USART& init_usart(bool use_dma_rx, bool use_dma_tx);
@@ -33,6 +34,10 @@ uint8_t rxbuffer[RX_DATA_SIZE];
 volatile uint8_t tx_count = 0;
 volatile uint16_t rx_count = 0;
 
+// printf output is queued here and drained by DMA0 channel 3
+uint8_t console_storage[512];
+static usart::Retarget* console = nullptr;
+
 __attribute__((constructor(101))) void premain() {
     CORTEX_DEVICE.set_nvic_priority_group(cortex::Priority_Group::PRIO_GROUP_PRE4SUB0);
     STARTUP_DEVICE.startup_init();
@@ -61,6 +66,12 @@ extern "C" void USART0_IRQHandler(void) {
     }
 }
 
+extern "C" void DMA0_Channel3_IRQHandler(void) {
+    if (console != nullptr) {
+        console->handle_dma_interrupt();
+    }
+}
+
 static usart::USART& init_usart(bool use_dma_rx, bool use_dma_tx) {
     auto usart_result = usart::USART::get_instance(usart::USART_Base::USART0_BASE);
     if (usart_result.error() != usart::USART_Error_Type::OK) {
@@ -173,6 +184,9 @@ static void usart_send_polling(usart::USART& usart, const char* data) {
 static void handle_error(const char* error_message) {
     // Implement error handling, such as logging to a file, flashing an LED, etc.
     printf("Error: %s\n", error_message);
+    if (console != nullptr) {
+        console->panic_flush();
+    }
     // Optionally halt execution
     while (true) {
         // Infinite loop to indicate error condition
@@ -186,6 +200,11 @@ int main() {
 
     NVIC_EnableIRQ(USART0_IRQn);
 
+    static usart::Retarget retarget(usart);
+    if (retarget.begin(console_storage, usart::Drain_Method::DRAIN_DMA, usart::Overflow_Policy::BLOCK) == usart::USART_Error_Type::OK) {
+        console = &retarget;
+    }
+
     // Transmit message using non-DMA USART (USART0 TX)
     usart_send_polling(usart, TX_MESSAGE);
     while (rx_count < RX_DATA_SIZE) {
@@ -194,12 +213,19 @@ int main() {
 
     // Output received data
     printf("\n\r%s\n\r", rxbuffer);
+    if (console != nullptr) {
+        console->panic_flush();
+    }
     return 0;
 }
 
 // Retarget printf to USART0 using __io_putchar
 int __io_putchar(int ch) {
-    // Get USART0 instance
+    if (console != nullptr) {
+        return console->put_char(ch);
+    }
+
+    // Console not started yet, fall back to polling
     auto usart_result = usart::USART::get_instance(usart::USART_Base::USART0_BASE);
     if (usart_result.error() != usart::USART_Error_Type::OK) {
         return -1;
@@ -0,0 +1,121 @@
+// gd32f303re USART COBS/SLIP framing benchmark
+// Copyright (c) B. Mourit <bnmguy@gmail.com
+// All rights reserved.
+
+#include <cstdio>
+#include <cstdint>
+
+#include "gd32f303re.h"
+
+#include "CORTEX.hpp"
+#include "RCU.hpp"
+#include "STARTUP.hpp"
+#include "USART.hpp"
+#include "USART_Framing.hpp"
+
+// Encodes a batch of packets into one stream and decodes it again, the way
+// a DMA idle report would hand it over, and prints packets per second.
+
+constexpr uint32_t BAUD_RATE = 115200;
+constexpr size_t PACKET_SIZE = 64;
+constexpr size_t PACKET_COUNT = 64;
+constexpr size_t ROUNDS = 16;
+constexpr size_t STREAM_SIZE = PACKET_COUNT * usart::Frame_Encoder::max_encoded_size(usart::Frame_Format::SLIP, PACKET_SIZE);
+
+uint8_t stream[STREAM_SIZE];
+uint8_t assembly[usart::Frame_Encoder::max_encoded_size(usart::Frame_Format::SLIP, PACKET_SIZE)];
+uint8_t packet[PACKET_SIZE];
+volatile uint32_t delivered = 0;
+
+__attribute__((constructor(101))) void premain() {
+    CORTEX_DEVICE.set_nvic_priority_group(cortex::Priority_Group::PRIO_GROUP_PRE4SUB0);
+    STARTUP_DEVICE.startup_init();
+}
+
+static usart::USART& init_usart() {
+    auto usart_result = usart::USART::get_instance(usart::USART_Base::USART0_BASE);
+    usart::USART& usart = usart_result.value();
+
+    usart::USART_Pins pin_config = {
+        .rx_pin = {gpio::GPIO_Base::GPIOA_BASE, gpio::Pin_Number::PIN_10, gpio::Pin_Mode::INPUT_PULLUP, gpio::Output_Speed::SPEED_10MHZ},
+        .tx_pin = {gpio::GPIO_Base::GPIOA_BASE, gpio::Pin_Number::PIN_9, gpio::Pin_Mode::ALT_PUSHPULL, gpio::Output_Speed::SPEED_10MHZ},
+    };
+    usart::USART_Config usart_config;
+    usart_config.baudrate = BAUD_RATE;
+    usart_config.dma_pin_ops = usart::USART_DMA_Config::DMA_NONE;
+    usart_config.word_length = usart::Word_Length::WL_8BITS;
+    usart_config.stop_bits = usart::Stop_Bits::STB_1BIT;
+    usart_config.parity = usart::Parity_Mode::PM_NONE;
+    usart_config.direction = usart::Direction_Mode::RXTX_MODE;
+    usart_config.msbf = usart::MSBF_Mode::MSBF_MSB;
+    usart.reset();
+    usart.pins_configure(pin_config);
+    usart.configure(usart_config);
+
+    return usart;
+}
+
+static void run_benchmark(usart::Frame_Format format, const char* name) {
+    usart::Frame_Encoder encoder(format);
+    usart::Frame_Decoder decoder(format, assembly, [](std::span<uint8_t> payload) {
+        delivered = delivered + payload.size();
+    });
+
+    uint32_t encode_cycles = 0;
+    uint32_t decode_cycles = 0;
+    delivered = 0;
+
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        uint32_t start = CORTEX_DEVICE.get_cycle_count();
+        size_t length = 0;
+        for (size_t i = 0; i < PACKET_COUNT; ++i) {
+            packet[0] = static_cast<uint8_t>(i);
+            length += encoder.encode(packet, std::span<uint8_t>(stream).subspan(length));
+        }
+        encode_cycles += CORTEX_DEVICE.get_cycle_count() - start;
+
+        start = CORTEX_DEVICE.get_cycle_count();
+        decoder.feed(std::span<uint8_t>(stream, length));
+        decode_cycles += CORTEX_DEVICE.get_cycle_count() - start;
+    }
+
+    const uint64_t packets = static_cast<uint64_t>(PACKET_COUNT) * ROUNDS;
+    const uint64_t clock = RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_SYS);
+    const usart::Frame_Counters counters = decoder.get_counters();
+
+    printf("%s: encode %lu pkt/s, decode %lu pkt/s, %lu frames, %lu crc errors\r\n", name,
+           static_cast<unsigned long>((packets * clock) / encode_cycles),
+           static_cast<unsigned long>((packets * clock) / decode_cycles),
+           static_cast<unsigned long>(counters.frames),
+           static_cast<unsigned long>(counters.crc_errors));
+}
+
+int main() {
+    init_usart();
+    CORTEX_DEVICE.set_cycle_counter_enable(true);
+
+    // Payload with a fair share of bytes that need stuffing
+    for (size_t i = 0; i < PACKET_SIZE; ++i) {
+        packet[i] = static_cast<uint8_t>((i % 8 == 0) ? 0x00 : (i % 8 == 1) ? 0xC0 : i);
+    }
+
+    printf("\r\nFraming benchmark, %u byte packets\r\n", static_cast<unsigned>(PACKET_SIZE));
+    run_benchmark(usart::Frame_Format::COBS, "COBS");
+    run_benchmark(usart::Frame_Format::SLIP, "SLIP");
+
+    while (true) {
+    }
+}
+
+int __io_putchar(int ch) {
+    auto usart_result = usart::USART::get_instance(usart::USART_Base::USART0_BASE);
+    if (usart_result.error() != usart::USART_Error_Type::OK) {
+        return -1;
+    }
+    usart::USART& usart0 = usart_result.value();
+
+    usart0.send_data(static_cast<uint16_t>(ch));
+    while (!usart0.get_flag(usart::Status_Flags::FLAG_TC)) {
+    }
+    return ch;
+}
@@ -11,6 +11,14 @@
 constexpr uint32_t Clear = 0;
 constexpr uint32_t Set = 1;
 
+// Convert a REG_BIT_DEF field into its in-register mask
+template <typename Bits>
+constexpr uint32_t bit_mask(Bits bits) {
+    const uint32_t width = static_cast<uint32_t>(bits) & 0xff;
+    const uint32_t bitno = static_cast<uint32_t>(bits) >> 16;
+    return ((width >= 32) ? 0xFFFFFFFFU : ((1U << width) - 1)) << bitno;
+}
+
 template <typename RegType, typename Instance>
 inline uint32_t read_bit(const Instance& instance, RegType reg, uint32_t bits, bool check_clock = false) {
     if (check_clock) {
@@ -171,8 +179,8 @@ inline void write_bit_with_channel_offset(const Instance& instance, RegType reg,
     const uint32_t width = bits & 0xff;
     const uint32_t bitno = bits >> 16;
 
-    regval &= ~(((1 << width) - 1) << (bitno << (static_cast<uint32_t>(channel) * 4)));
-    regval |= (value << (bitno << (static_cast<uint32_t>(channel) * 4)));
+    regval &= ~(((1 << width) - 1) << (bitno + (static_cast<uint32_t>(channel) * 4)));
+    regval |= (value << (bitno + (static_cast<uint32_t>(channel) * 4)));
 
     *instance.reg_address(reg) = regval;
 }
@@ -0,0 +1,108 @@
+// Word-at-a-time byte search
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "RingBuffer.hpp"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "gd32f303re.h"
+#endif
+
+//
+// Finds a delimiter ('\n', 0x00, 0xC0 ...) testing four bytes per
+// iteration. On the Cortex-M4 the match is built with UADD8/SEL: adding
+// 0xFF to each byte of (word ^ pattern) carries out, setting GE, for every
+// byte that differs, and SEL turns the bytes without GE into 0xFF. Other
+// targets (host builds) use the classic SWAR zero-byte test, which is exact
+// for the lowest matching byte, the only one that is used.
+//
+
+namespace byte_scan {
+
+constexpr uint32_t broadcast(uint8_t value) {
+    return static_cast<uint32_t>(value) * 0x01010101U;
+}
+
+// Non-zero with the lowest set byte marking the first match, little endian
+inline uint32_t match_mask(uint32_t word, uint32_t pattern) {
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    __UADD8(word ^ pattern, 0xFFFFFFFFU);
+    return __SEL(0U, 0xFFFFFFFFU);
+#else
+    const uint32_t value = word ^ pattern;
+    return (value - 0x01010101U) & ~value & 0x80808080U;
+#endif
+}
+
+inline size_t first_match_index(uint32_t mask) {
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    return __CLZ(__RBIT(mask)) >> 3;
+#else
+    return static_cast<size_t>(__builtin_ctz(mask)) >> 3;
+#endif
+}
+
+} // namespace byte_scan
+
+// Index of the first byte equal to value, data.size() if there is none
+inline size_t find_byte(std::span<const uint8_t> data, uint8_t value) {
+    const uint8_t* const begin = data.data();
+    const size_t size = data.size();
+    size_t index = 0;
+
+    // Single bytes up to the first word boundary
+    while ((index < size) && ((reinterpret_cast<uintptr_t>(begin + index) & (sizeof(uint32_t) - 1)) != 0)) {
+        if (begin[index] == value) {
+            return index;
+        }
+        ++index;
+    }
+
+    const uint32_t pattern = byte_scan::broadcast(value);
+    while ((size - index) >= sizeof(uint32_t)) {
+        uint32_t word;
+        std::memcpy(&word, begin + index, sizeof(word));
+        const uint32_t mask = byte_scan::match_mask(word, pattern);
+        if (mask != 0) {
+            return index + byte_scan::first_match_index(mask);
+        }
+        index += sizeof(uint32_t);
+    }
+
+    while (index < size) {
+        if (begin[index] == value) {
+            return index;
+        }
+        ++index;
+    }
+    return size;
+}
+
+//
+// Search the unread part of a ring, including the region that wraps past
+// the end of storage. Scanning starts offset bytes past the tail. On a match
+// offset is set to the match and true is returned, otherwise offset is left
+// at the end of the data scanned so a later call resumes from there.
+// Consumer side only.
+//
+inline bool find_byte(const Ring_Buffer<uint8_t>& ring, uint8_t value, size_t& offset) {
+    while (true) {
+        const std::span<const uint8_t> region = ring.read_span(offset);
+        if (region.empty()) {
+            return false;
+        }
+        const size_t index = find_byte(region, value);
+        if (index < region.size()) {
+            offset += index;
+            return true;
+        }
+        offset += region.size();
+    }
+}
@@ -0,0 +1,177 @@
+// Single-producer single-consumer ring buffer
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+//
+// Lock-free ring buffer for exactly one producer and one consumer, such as an
+// ISR on one side and thread code on the other. Storage is supplied by the
+// caller and its size must be a power of two so indices wrap with a mask.
+// Head and tail are free running counters, so every slot can be used.
+//
+// Only the producer may call push/write/write_span/commit, and only the
+// consumer may call pop/read/read_span/consume. clear() must only be called
+// while neither side is active.
+//
+template <typename T>
+class Ring_Buffer {
+public:
+    Ring_Buffer() = default;
+    explicit Ring_Buffer(std::span<T> storage) {
+        attach(storage);
+    }
+
+    // Attach backing storage, returns false if the size is not a power of two
+    bool attach(std::span<T> storage) {
+        const size_t size = storage.size();
+        if ((size == 0) || ((size & (size - 1)) != 0)) {
+            buffer_ = nullptr;
+            mask_ = 0;
+            clear();
+            return false;
+        }
+        buffer_ = storage.data();
+        mask_ = static_cast<uint32_t>(size - 1);
+        clear();
+        return true;
+    }
+
+    void clear() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    bool is_attached() const {
+        return buffer_ != nullptr;
+    }
+    size_t capacity() const {
+        return (buffer_ != nullptr) ? static_cast<size_t>(mask_) + 1 : 0;
+    }
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    size_t free_space() const {
+        return capacity() - size();
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+    bool full() const {
+        return size() == capacity();
+    }
+
+    // Producer side
+    bool push(const T& value) {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if ((head - tail_.load(std::memory_order_acquire)) >= capacity()) {
+            return false;
+        }
+        buffer_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Copy as much of data as fits, returns the number of elements accepted
+    size_t write(std::span<const T> data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            std::span<T> dest = write_span();
+            if (dest.empty()) {
+                break;
+            }
+            const size_t count = std::min(dest.size(), data.size() - written);
+            for (size_t i = 0; i < count; ++i) {
+                dest[i] = data[written + i];
+            }
+            commit(count);
+            written += count;
+        }
+        return written;
+    }
+
+    // Largest contiguous free region starting at head, filled in place then commit()
+    std::span<T> write_span() const {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const size_t free_count = capacity() - (head - tail_.load(std::memory_order_acquire));
+        const size_t index = head & mask_;
+        return std::span<T>(buffer_ + index, std::min(free_count, capacity() - index));
+    }
+
+    void commit(size_t count) {
+        head_.store(head_.load(std::memory_order_relaxed) + static_cast<uint32_t>(count), std::memory_order_release);
+    }
+
+    // Consumer side
+    bool pop(T& value) {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+        value = buffer_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Copy out up to data.size() elements, returns the number of elements read
+    size_t read(std::span<T> data) {
+        size_t read_count = 0;
+        while (read_count < data.size()) {
+            std::span<const T> src = read_span();
+            if (src.empty()) {
+                break;
+            }
+            const size_t count = std::min(src.size(), data.size() - read_count);
+            for (size_t i = 0; i < count; ++i) {
+                data[read_count + i] = src[i];
+            }
+            consume(count);
+            read_count += count;
+        }
+        return read_count;
+    }
+
+    // Largest contiguous filled region starting at tail, used in place then consume()
+    std::span<const T> read_span() const {
+        return read_span(0);
+    }
+
+    // Same, starting offset elements past tail, for scanning without consuming
+    std::span<const T> read_span(size_t offset) const {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t used = head_.load(std::memory_order_acquire) - tail;
+        if (offset >= used) {
+            return std::span<const T>();
+        }
+        const size_t index = (tail + offset) & mask_;
+        return std::span<const T>(buffer_ + index, std::min(used - offset, capacity() - index));
+    }
+
+    // Writable view of queued elements for updating them in place. Outside the
+    // single producer/consumer contract, the caller serialises with both sides.
+    std::span<T> update_span(size_t offset) {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t used = head_.load(std::memory_order_acquire) - tail;
+        if (offset >= used) {
+            return std::span<T>();
+        }
+        const size_t index = (tail + offset) & mask_;
+        return std::span<T>(buffer_ + index, std::min(used - offset, capacity() - index));
+    }
+
+    void consume(size_t count) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + static_cast<uint32_t>(count), std::memory_order_release);
+    }
+
+private:
+    T* buffer_ = nullptr;
+    uint32_t mask_ = 0;
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+};
@@ -0,0 +1,103 @@
+// Queue of bus transactions with blocking completions
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "RingBuffer.hpp"
+
+// Result slot of a blocking transaction, lives on the caller's stack
+template <typename Status>
+struct Completion {
+    volatile bool done = false;
+    volatile Status status = Status::OK;
+};
+
+//
+// Transactions waiting for a bus, run front first by the driver. Each one
+// carries a callback and a Completion pointer, either may be empty. A
+// blocking caller that gives up cannot leave a pointer to its stack behind,
+// so its queued entry is pointed at an internal sink and skipped once it
+// reaches the front.
+//
+// Transaction needs members callback, invocable with a Status, and
+// completion, a Completion<Status>*. Apart from finish(), which takes its
+// own critical section, callers hold interrupts off: producers may be tasks
+// and interrupts of any priority.
+//
+template <typename Transaction, typename Status>
+class Transaction_Queue {
+public:
+    // Storage size must be a power of two
+    bool attach(std::span<Transaction> storage) {
+        return queue_.attach(storage);
+    }
+    void clear() {
+        queue_.clear();
+    }
+    bool push(const Transaction& transaction) {
+        return queue_.push(transaction);
+    }
+    bool empty() const {
+        return queue_.empty();
+    }
+    size_t size() const {
+        return queue_.size();
+    }
+    const Transaction& front() const {
+        return queue_.read_span()[0];
+    }
+
+    // Drops abandoned entries from the front, false when none are left
+    bool skip_discarded() {
+        while (!queue_.empty() && is_discarded(front())) {
+            queue_.consume(1);
+        }
+        return !queue_.empty();
+    }
+    bool is_discarded(const Transaction& transaction) const {
+        return transaction.completion == &discarded_;
+    }
+    bool is_front(const Completion<Status>& completion) const {
+        return !queue_.empty() && (front().completion == &completion);
+    }
+
+    // Fills the slot of a caller giving up and detaches it from its entry
+    void discard(Completion<Status>& completion, Status status) {
+        for (size_t offset = 0; offset < queue_.size(); ++offset) {
+            Transaction& transaction = queue_.update_span(offset)[0];
+            if (transaction.completion == &completion) {
+                transaction.completion = &discarded_;
+                break;
+            }
+        }
+        completion.status = status;
+        completion.done = true;
+    }
+
+    // Pops the front transaction and reports its status, the callback runs
+    // with interrupts enabled
+    void finish(Status status) {
+        const auto callback = front().callback;
+        {
+            cortex::Critical_Section section;
+            Completion<Status>* completion = front().completion;
+            if (completion != nullptr) {
+                completion->status = status;
+                completion->done = true;
+            }
+            queue_.consume(1);
+        }
+        if (callback) {
+            callback(status);
+        }
+    }
+
+private:
+    Ring_Buffer<Transaction> queue_;
+    Completion<Status> discarded_;
+};
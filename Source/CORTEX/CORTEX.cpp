@@ -78,6 +78,18 @@ void CORTEX::nvic_irq_disable(uint8_t irq)
     NVIC->ICER[irq >> 5] = static_cast<uint32_t>(1 << (irq & 0x1F));
 }
 
+// Enable or disable the DWT cycle counter used by Deadline
+void CORTEX::set_cycle_counter_enable(bool enable)
+{
+    if (enable) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    } else {
+        DWT->CTRL &= ~DWT_CTRL_CYCCNTENA_Msk;
+    }
+}
+
 } // namespace cortex
 
 cortex::CORTEX CORTEX_DEVICE;
@@ -6,6 +6,7 @@
 
 #include <cstdlib>
 
+#include "gd32f303re.h"
 #include "cortex_config.hpp"
 
 namespace cortex {
@@ -24,6 +25,62 @@ public:
     // Interrupts
     void nvic_irq_enable(uint8_t irq, uint8_t preemption_priority, uint8_t sub_priority);
     void nvic_irq_disable(uint8_t irq);
+    // DWT cycle counter
+    void set_cycle_counter_enable(bool enable);
+    inline uint32_t get_cycle_count() const {
+        return DWT->CYCCNT;
+    }
+};
+
+//
+// Timeout measured in core clock cycles using the DWT cycle counter.
+// The counter must be running (CORTEX::set_cycle_counter_enable), otherwise
+// a deadline never expires. Wraparound safe for timeouts below 2^32 cycles.
+//
+class Deadline {
+public:
+    static constexpr uint32_t Infinite = 0xFFFFFFFF;
+
+    explicit Deadline(uint32_t cycles) : start_(DWT->CYCCNT), cycles_(cycles) {}
+
+    bool expired() const {
+        return (cycles_ != Infinite) && ((DWT->CYCCNT - start_) >= cycles_);
+    }
+    uint32_t elapsed() const {
+        return DWT->CYCCNT - start_;
+    }
+    // Cycles left, for passing the same deadline to a nested wait
+    uint32_t remaining() const {
+        if (cycles_ == Infinite) {
+            return Infinite;
+        }
+        const uint32_t used = elapsed();
+        return (used >= cycles_) ? 0 : (cycles_ - used);
+    }
+
+private:
+    uint32_t start_;
+    uint32_t cycles_;
+};
+
+//
+// Masks interrupts for the lifetime of the object and restores the previous
+// PRIMASK state on exit, so sections may nest and may be used inside ISRs.
+//
+class Critical_Section {
+public:
+    Critical_Section() : primask_(__get_PRIMASK()) {
+        __disable_irq();
+    }
+    ~Critical_Section() {
+        __set_PRIMASK(primask_);
+    }
+
+    Critical_Section(const Critical_Section&) = delete;
+    Critical_Section& operator=(const Critical_Section&) = delete;
+
+private:
+    uint32_t primask_;
 };
 
 } // namespace cortex
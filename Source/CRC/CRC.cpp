@@ -46,6 +46,24 @@ uint32_t CRC::calculate_mulitple_data(const uint32_t *data, uint32_t size) {
     return read_register<uint32_t>(*this, CRC_Regs::DATA, true);
 }
 
+uint32_t CRC::calculate_byte_data(const uint8_t *data, uint32_t size) {
+    uint32_t word;
+
+    // memcpy keeps unaligned buffers legal, it compiles to a single load
+    while (size >= sizeof(word)) {
+        std::memcpy(&word, data, sizeof(word));
+        write_register(*this, CRC_Regs::DATA, word, true);
+        data += sizeof(word);
+        size -= sizeof(word);
+    }
+    if (size != 0) {
+        word = 0;
+        std::memcpy(&word, data, size);
+        write_register(*this, CRC_Regs::DATA, word, true);
+    }
+    return read_register<uint32_t>(*this, CRC_Regs::DATA, true);
+}
+
 } // namespace crc
 
 crc::CRC CRC_DEVICE;
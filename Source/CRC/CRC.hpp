@@ -5,6 +5,7 @@
 #pragma once
 
 #include <cstdlib>
+#include <cstring>
 
 #include "RegRW.hpp"
 #include "RCU.hpp"
@@ -27,6 +28,8 @@ public:
     // Calculate
     uint32_t calculate_data(uint32_t data);
     uint32_t calculate_mulitple_data(const uint32_t *array, uint32_t size);
+    // Byte stream, packed little endian into words with the last word zero padded
+    uint32_t calculate_byte_data(const uint8_t *data, uint32_t size);
 
     // Base address
     static constexpr uintptr_t CRC_baseAddress = 0x40023000;
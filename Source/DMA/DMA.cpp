@@ -165,6 +165,52 @@ void DMA::clear_interrupt_flag(DMA_Channel channel, Interrupt_Flags flag) {
     write_bit_with_channel_offset(*this, DMA_Regs::INTC, static_cast<uint32_t>(flag), channel, Set);
 }
 
+//
+// Read INTF once and return the flags of every channel on this DMA.
+// Shared IRQ handlers should use this instead of calling get_flag()
+// per flag and per channel, which costs one INTF read each time.
+//
+DMA_Status_Snapshot DMA::get_status_snapshot() {
+    return DMA_Status_Snapshot{ read_register<uint32_t>(*this, DMA_Regs::INTF) & valid_flags_mask() };
+}
+
+//
+// Same as get_status_snapshot(), but FTF/HTF/ERR are only reported when the
+// matching interrupt is enabled in CHXCTL. channel_mask selects the channels
+// to check (bit N = channel N) so only those CHXCTL registers are read.
+// GIF is reported if any of the remaining flags for the channel are set.
+//
+DMA_Status_Snapshot DMA::get_interrupt_snapshot(uint32_t channel_mask) {
+    const uint32_t intf = read_register<uint32_t>(*this, DMA_Regs::INTF) & valid_flags_mask();
+    constexpr uint32_t InterruptEnableMask = 0xE;   // FTFIE, HTFIE, ERRIE share bit positions with INTF
+    uint32_t flags = 0;
+
+    for (uint32_t channel = 0; channel_mask != 0; ++channel, channel_mask >>= 1) {
+        if (channel_validity(static_cast<DMA_Channel>(channel)) != true) {
+            break;
+        }
+        if ((channel_mask & 1U) == 0) {
+            continue;
+        }
+        const uint32_t shift = channel * ChannelFlagWidth;
+        uint32_t pending = (intf >> shift) & InterruptEnableMask;
+        if (pending == 0) {
+            continue;
+        }
+        pending &= read_register<uint32_t>(*this, DMA_Regs::CHXCTL, static_cast<DMA_Channel>(channel)) & InterruptEnableMask;
+        if (pending != 0) {
+            flags |= (pending | 1U) << shift;
+        }
+    }
+
+    return DMA_Status_Snapshot{ flags };
+}
+
+// Clear any combination of channel flags with a single INTC write
+void DMA::clear_flags(uint32_t mask) {
+    write_register(*this, DMA_Regs::INTC, mask & valid_flags_mask());
+}
+
 // Enable or disable interrupt
 void DMA::set_interrupt_enable(DMA_Channel channel, Interrupt_Type type, bool enable) {
     if (channel_validity(channel) != true) {
@@ -62,6 +62,10 @@ public:
     // Interrupt flags
     bool get_interrupt_flag(DMA_Channel channel, Interrupt_Flags flag);
     void clear_interrupt_flag(DMA_Channel channel, Interrupt_Flags flag);
+    // Bulk flag access
+    DMA_Status_Snapshot get_status_snapshot();
+    DMA_Status_Snapshot get_interrupt_snapshot(uint32_t channel_mask);
+    void clear_flags(uint32_t mask);
     // Interrupts
     void set_interrupt_enable(DMA_Channel channel, Interrupt_Type type, bool enable);
 
@@ -113,6 +117,9 @@ private:
     }
 
     inline bool channel_validity(DMA_Channel channel);
+    inline uint32_t valid_flags_mask() const {
+        return (dma_base_index_ == DMA_Base::DMA1_BASE) ? 0x000FFFFFU : 0x0FFFFFFFU;
+    }
 };
 
 } // namespace dma
@@ -25,6 +25,25 @@ static constexpr uintptr_t DMA_baseAddress[] = {
     0x40020400,
 };
 
+static constexpr IRQn_Type DMA0_irqNumber[] = {
+    DMA0_Channel0_IRQn,
+    DMA0_Channel1_IRQn,
+    DMA0_Channel2_IRQn,
+    DMA0_Channel3_IRQn,
+    DMA0_Channel4_IRQn,
+    DMA0_Channel5_IRQn,
+    DMA0_Channel6_IRQn,
+};
+
+// DMA1 channel 3 and channel 4 share an interrupt line
+static constexpr IRQn_Type DMA1_irqNumber[] = {
+    DMA1_Channel0_IRQn,
+    DMA1_Channel1_IRQn,
+    DMA1_Channel2_IRQn,
+    DMA1_Channel3_Channel4_IRQn,
+    DMA1_Channel3_Channel4_IRQn,
+};
+
 
 ///////////////////////////// REGISTER OFFSETS /////////////////////////////
 
@@ -83,6 +102,10 @@ enum class DMA_Channel {
     CHANNEL6,
 };
 
+constexpr IRQn_Type get_irq_number(DMA_Base base, DMA_Channel channel) {
+    return (base == DMA_Base::DMA0_BASE) ? DMA0_irqNumber[static_cast<int>(channel)] : DMA1_irqNumber[static_cast<int>(channel)];
+}
+
 enum class Status_Flags {
     FLAG_GIF = REG_BIT_DEF(0, 0),
     FLAG_FTFIF = REG_BIT_DEF(1, 1), // Full transfer fifo is full
@@ -168,4 +191,38 @@ struct DMA_Config {
     Transfer_Direction direction = Transfer_Direction::P2M;
 };
 
+// INTF and INTC share the same layout: four flag bits per channel,
+// with channel N occupying bits [4N+3:4N].
+constexpr uint32_t ChannelFlagWidth = 4;
+constexpr uint32_t ChannelFlagMask = 0xF;
+
+// Returns the INTF/INTC bit for a single channel flag
+constexpr uint32_t channel_flag_mask(DMA_Channel channel, Status_Flags flag) {
+    return 1U << ((static_cast<uint32_t>(flag) >> 16) + (static_cast<uint32_t>(channel) * ChannelFlagWidth));
+}
+
+// Returns all four INTF/INTC bits for a channel
+constexpr uint32_t channel_all_flags_mask(DMA_Channel channel) {
+    return ChannelFlagMask << (static_cast<uint32_t>(channel) * ChannelFlagWidth);
+}
+
+// Decoded copy of INTF taken with a single register read.
+// The raw value can be passed straight to DMA::clear_flags().
+struct DMA_Status_Snapshot {
+    uint32_t flags = 0;
+
+    bool test(DMA_Channel channel, Status_Flags flag) const {
+        return (flags & channel_flag_mask(channel, flag)) != 0;
+    }
+    uint32_t channel_flags(DMA_Channel channel) const {
+        return (flags >> (static_cast<uint32_t>(channel) * ChannelFlagWidth)) & ChannelFlagMask;
+    }
+    bool any(DMA_Channel channel) const {
+        return channel_flags(channel) != 0;
+    }
+    bool empty() const {
+        return flags == 0;
+    }
+};
+
 } // namespace dma
@@ -135,6 +135,7 @@ void I2C::set_direction_address(Transfer_Direction direction, uint32_t address)
 
 void I2C::set_dual_address_enable(uint32_t address, bool enable) {
     if (enable) {
+        // Unshifted 7-bit address, the field itself sits at bits 7:1
         address &= Address2Mask;
         write_bit(*this, I2C_Regs::SADDR1, static_cast<uint32_t>(SADDR1_Bits::ADDRESS2), address);
     }
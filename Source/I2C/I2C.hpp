@@ -78,11 +78,17 @@ public:
         return reinterpret_cast<volatile uint32_t *>(base_address_ + static_cast<uint32_t>(reg));
     }
 
+    const I2C_Pins& get_pins_config() const {
+        return pin_config_;
+    }
+
     // Function to keep compiler happy
     inline void ensure_clock_enabled() const {}
 
+    I2C_Base base_index_;
+
 private:
-    I2C(I2C_Base Base) : I2C_pclk_info_(I2C_pclk_index[static_cast<int>(Base)]),
+    I2C(I2C_Base Base) : base_index_(Base), I2C_pclk_info_(I2C_pclk_index[static_cast<int>(Base)]),
         base_address_(I2C_baseAddress[static_cast<int>(Base)]) {
         if (!is_clock_enabled) {
             RCU_DEVICE.set_pclk_enable(I2C_pclk_info_.clock_reg, true);
@@ -0,0 +1,201 @@
+// gd32f30x I2C serial EEPROM in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <algorithm>
+
+#include "I2C_EEPROM.hpp"
+
+namespace i2c {
+
+// Device address bits A2-A0 that double as memory address bits
+constexpr uint32_t BlockSelectMask = 0x07;
+// Sequential reads are split where the block select bits change
+constexpr uint32_t ReadBoundary = 0x10000;
+
+I2C_Error_Type EEPROM::begin(const EEPROM_Config& config) {
+    const bool page_power_of_two = (config.page_size != 0) && ((config.page_size & (config.page_size - 1)) == 0);
+    if ((config.address > 0x7F) || (config.size == 0) || !page_power_of_two || (config.page_size > MaximumPageSize) ||
+            ((config.address_bytes != 1) && (config.address_bytes != 2))) {
+        return I2C_Error_Type::INVALID_SELECTION;
+    }
+    if (busy_) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    config_ = config;
+    polls_ = 0;
+    configured_ = true;
+    return I2C_Error_Type::OK;
+}
+
+I2C_Error_Type EEPROM::write(uint32_t address, std::span<const uint8_t> data, Operation_Callback callback) {
+    I2C_Error_Type result = start(address, data.size(), callback);
+    if (result != I2C_Error_Type::OK) {
+        return result;
+    }
+    tx_ = data;
+    result = write_next_page();
+    if (result != I2C_Error_Type::OK) {
+        callback_ = nullptr;
+        busy_ = false;
+    }
+    return result;
+}
+
+I2C_Error_Type EEPROM::read(uint32_t address, std::span<uint8_t> data, Operation_Callback callback) {
+    I2C_Error_Type result = start(address, data.size(), callback);
+    if (result != I2C_Error_Type::OK) {
+        return result;
+    }
+    rx_ = data;
+    result = read_next_chunk();
+    if (result != I2C_Error_Type::OK) {
+        callback_ = nullptr;
+        busy_ = false;
+    }
+    return result;
+}
+
+I2C_Error_Type EEPROM::write_blocking(uint32_t address, std::span<const uint8_t> data) {
+    I2C_Error_Type result = write(address, data);
+    if (result != I2C_Error_Type::OK) {
+        return result;
+    }
+    return wait();
+}
+
+I2C_Error_Type EEPROM::read_blocking(uint32_t address, std::span<uint8_t> data) {
+    I2C_Error_Type result = read(address, data);
+    if (result != I2C_Error_Type::OK) {
+        return result;
+    }
+    return wait();
+}
+
+I2C_Error_Type EEPROM::start(uint32_t address, size_t length, Operation_Callback callback) {
+    if (!configured_ || busy_) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    if ((length == 0) || (address >= config_.size) || (length > (config_.size - address))) {
+        return I2C_Error_Type::INVALID_SELECTION;
+    }
+    busy_ = true;
+    status_ = I2C_Error_Type::OK;
+    callback_ = callback;
+    address_ = address;
+    tx_ = std::span<const uint8_t>();
+    rx_ = std::span<uint8_t>();
+    return I2C_Error_Type::OK;
+}
+
+uint8_t EEPROM::device_address(uint32_t address) const {
+    return static_cast<uint8_t>(config_.address | ((address >> (8 * config_.address_bytes)) & BlockSelectMask));
+}
+
+size_t EEPROM::put_address(uint32_t address) {
+    if (config_.address_bytes == 2) {
+        buffer_[0] = static_cast<uint8_t>(address >> 8);
+        buffer_[1] = static_cast<uint8_t>(address);
+        return 2;
+    }
+    buffer_[0] = static_cast<uint8_t>(address);
+    return 1;
+}
+
+I2C_Error_Type EEPROM::write_next_page() {
+    const size_t page_size = config_.page_size;
+    chunk_ = std::min(tx_.size(), page_size - (address_ & (page_size - 1)));
+    const size_t header = put_address(address_);
+    std::copy_n(tx_.data(), chunk_, buffer_.data() + header);
+
+    auto callback = [this](I2C_Error_Type status) {
+        on_page_written(status);
+    };
+    return master_.write(device_address(address_), std::span<const uint8_t>(buffer_.data(), header + chunk_), callback);
+}
+
+void EEPROM::on_page_written(I2C_Error_Type status) {
+    if (status != I2C_Error_Type::OK) {
+        finish(status);
+        return;
+    }
+    address_ = address_ + static_cast<uint32_t>(chunk_);
+    tx_ = tx_.subspan(chunk_);
+    // The write cycle starts at the STOP, the part NACKs its address until done
+    write_deadline_ = cortex::Deadline(config_.write_timeout_cycles);
+    probe();
+}
+
+void EEPROM::probe() {
+    auto callback = [this](I2C_Error_Type status) {
+        on_probe(status);
+    };
+    I2C_Error_Type result = master_.submit(config_.address, std::span<const uint8_t>(), std::span<uint8_t>(), callback);
+    if (result != I2C_Error_Type::OK) {
+        finish(result);
+    }
+}
+
+void EEPROM::on_probe(I2C_Error_Type status) {
+    if (status == I2C_Error_Type::OK) {
+        if (tx_.empty()) {
+            finish(I2C_Error_Type::OK);
+            return;
+        }
+        status = write_next_page();
+        if (status != I2C_Error_Type::OK) {
+            finish(status);
+        }
+    } else if ((status == I2C_Error_Type::NACK) && !write_deadline_.expired()) {
+        polls_ = polls_ + 1;
+        probe();
+    } else {
+        finish((status == I2C_Error_Type::NACK) ? I2C_Error_Type::TIMEOUT : status);
+    }
+}
+
+I2C_Error_Type EEPROM::read_next_chunk() {
+    chunk_ = std::min({rx_.size(), MaximumReadLength, static_cast<size_t>(ReadBoundary - (address_ & (ReadBoundary - 1)))});
+    const size_t header = put_address(address_);
+
+    auto callback = [this](I2C_Error_Type status) {
+        on_chunk_read(status);
+    };
+    return master_.write_read(device_address(address_), std::span<const uint8_t>(buffer_.data(), header),
+                              rx_.first(chunk_), callback);
+}
+
+void EEPROM::on_chunk_read(I2C_Error_Type status) {
+    if (status != I2C_Error_Type::OK) {
+        finish(status);
+        return;
+    }
+    address_ = address_ + static_cast<uint32_t>(chunk_);
+    rx_ = rx_.subspan(chunk_);
+    if (rx_.empty()) {
+        finish(I2C_Error_Type::OK);
+        return;
+    }
+    status = read_next_chunk();
+    if (status != I2C_Error_Type::OK) {
+        finish(status);
+    }
+}
+
+void EEPROM::finish(I2C_Error_Type status) {
+    const Operation_Callback callback = callback_;
+    status_ = status;
+    busy_ = false;
+    if (callback) {
+        callback(status);
+    }
+}
+
+I2C_Error_Type EEPROM::wait() {
+    while (busy_) {
+        master_.poll();
+    }
+    return status_;
+}
+
+} // namespace i2c
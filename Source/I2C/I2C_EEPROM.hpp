@@ -0,0 +1,91 @@
+// gd32f30x I2C serial EEPROM in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "I2C_Master.hpp"
+
+namespace i2c {
+
+//
+// 24Cxx EEPROM on an I2C_Master bus. Writes are split at page boundaries
+// and each page goes out as one transaction, so a page costs one write
+// cycle instead of one per byte. The end of the write cycle is found by
+// ACK polling: address probes are queued until the part acknowledges,
+// bounded by the configured timeout, so other devices on the bus keep being
+// served in between.
+//
+// Reads are one sequential read per 64 KB, the part increments its address
+// across pages by itself; with a DMA threshold set on the master the data
+// moves by DMA. Each page is copied behind its address bytes, as the master
+// sends a single buffer per write.
+//
+// Operations run in the background through the master's callbacks; one
+// operation at a time. The blocking versions spin on poll() so the master's
+// transaction deadlines still apply.
+//
+class EEPROM {
+public:
+    using Operation_Callback = std::function<void(I2C_Error_Type status)>;
+
+    static constexpr size_t MaximumPageSize = 256;
+    static constexpr size_t MaximumReadLength = 0xFFFF;
+
+    explicit EEPROM(I2C_Master& master) : master_(master) {}
+
+    I2C_Error_Type begin(const EEPROM_Config& config);
+
+    // Buffers must stay valid until the callback runs
+    I2C_Error_Type write(uint32_t address, std::span<const uint8_t> data, Operation_Callback callback = nullptr);
+    I2C_Error_Type read(uint32_t address, std::span<uint8_t> data, Operation_Callback callback = nullptr);
+    I2C_Error_Type write_blocking(uint32_t address, std::span<const uint8_t> data);
+    I2C_Error_Type read_blocking(uint32_t address, std::span<uint8_t> data);
+
+    bool is_busy() const {
+        return busy_;
+    }
+    uint32_t get_size() const {
+        return config_.size;
+    }
+    // Probes that were NACKed while a page was being written
+    uint32_t get_poll_count() const {
+        return polls_;
+    }
+
+private:
+    I2C_Master& master_;
+    EEPROM_Config config_ = {};
+    bool configured_ = false;
+
+    std::array<uint8_t, MaximumPageSize + 2> buffer_ = {};
+    volatile bool busy_ = false;
+    volatile I2C_Error_Type status_ = I2C_Error_Type::OK;
+    Operation_Callback callback_;
+    uint32_t address_ = 0;
+    std::span<const uint8_t> tx_;
+    std::span<uint8_t> rx_;
+    size_t chunk_ = 0;
+    cortex::Deadline write_deadline_{cortex::Deadline::Infinite};
+    volatile uint32_t polls_ = 0;
+
+    I2C_Error_Type start(uint32_t address, size_t length, Operation_Callback callback);
+    uint8_t device_address(uint32_t address) const;
+    size_t put_address(uint32_t address);
+    I2C_Error_Type write_next_page();
+    void on_page_written(I2C_Error_Type status);
+    void probe();
+    void on_probe(I2C_Error_Type status);
+    I2C_Error_Type read_next_chunk();
+    void on_chunk_read(I2C_Error_Type status);
+    void finish(I2C_Error_Type status);
+    I2C_Error_Type wait();
+};
+
+} // namespace i2c
@@ -0,0 +1,719 @@
+// gd32f30x I2C interrupt driven master in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <algorithm>
+
+#include "I2C_Master.hpp"
+
+namespace i2c {
+
+// Longest wait for a STOP to complete, or for a stretched SCL to rise
+constexpr uint32_t BusFreeHalfPeriods = 8;
+
+constexpr uint32_t ErrorFlags = bit_mask(STAT0_Bits::BERR) | bit_mask(STAT0_Bits::LOSTARB) |
+                                bit_mask(STAT0_Bits::AERR) | bit_mask(STAT0_Bits::OUERR) |
+                                bit_mask(STAT0_Bits::PECERR) | bit_mask(STAT0_Bits::SMBTO) |
+                                bit_mask(STAT0_Bits::SMBALT);
+
+I2C_Error_Type I2C_Master::begin(std::span<Transaction> queue_storage, uint32_t timeout_cycles) {
+    if (!queue_.attach(queue_storage)) {
+        return I2C_Error_Type::INITIALIZATION_FAILED;
+    }
+
+    const I2C_Pins& pins = i2c_.get_pins_config();
+    auto scl_result = gpio::GPIO::get_instance(pins.scl_pin.gpio_port);
+    if (scl_result.error() != gpio::GPIO_Error_Type::OK) {
+        return I2C_Error_Type::INITIALIZATION_FAILED;
+    }
+    auto sda_result = gpio::GPIO::get_instance(pins.sda_pin.gpio_port);
+    if (sda_result.error() != gpio::GPIO_Error_Type::OK) {
+        return I2C_Error_Type::INITIALIZATION_FAILED;
+    }
+    scl_port_ = &scl_result.value();
+    sda_port_ = &sda_result.value();
+    scl_mask_ = 1U << static_cast<uint32_t>(pins.scl_pin.pin);
+    sda_mask_ = 1U << static_cast<uint32_t>(pins.sda_pin.pin);
+    // Deadline counts DWT cycles, which run at HCLK
+    half_period_cycles_ = RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_AHB) / (2 * RecoveryClockFrequency);
+
+    timeout_cycles_ = timeout_cycles;
+    busy_ = false;
+    active_ = false;
+    recovery_needed_ = false;
+    recoveries_ = 0;
+    timeouts_ = 0;
+
+    write_bits(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::EVIE), Clear,
+               static_cast<uint32_t>(CTL1_Bits::BUFIE), Clear,
+               static_cast<uint32_t>(CTL1_Bits::DMAON), Clear,
+               static_cast<uint32_t>(CTL1_Bits::ERRIE), Set);
+    NVIC_EnableIRQ(I2C_ev_irqNumber[static_cast<int>(i2c_.base_index_)]);
+    NVIC_EnableIRQ(I2C_er_irqNumber[static_cast<int>(i2c_.base_index_)]);
+    i2c_.set_enable(true);
+    running_ = true;
+
+    // A slave left in the middle of a read by a reset holds SDA low
+    if (!wait_bus_free()) {
+        recover_bus();
+    }
+    return I2C_Error_Type::OK;
+}
+
+void I2C_Master::end() {
+    cortex::Critical_Section section;
+    running_ = false;
+    write_bits(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::EVIE), Clear,
+               static_cast<uint32_t>(CTL1_Bits::BUFIE), Clear,
+               static_cast<uint32_t>(CTL1_Bits::ERRIE), Clear);
+    if (active_) {
+        i2c_.generate_stop_condition();
+    }
+    stop_dma();
+    queue_.clear();
+    active_ = false;
+    busy_ = false;
+}
+
+I2C_Error_Type I2C_Master::submit(uint8_t address, std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                                  Transaction_Callback callback) {
+    return enqueue(Transaction{address, tx, rx, callback, nullptr});
+}
+
+I2C_Error_Type I2C_Master::submit(const Transaction& transaction) {
+    Transaction queued = transaction;
+    queued.completion = nullptr;
+    if (queued.block_read && (queued.rx.size() < MinimumBlockReadLength)) {
+        return I2C_Error_Type::INVALID_SELECTION;
+    }
+    return enqueue(queued);
+}
+
+I2C_Error_Type I2C_Master::transfer_blocking(uint8_t address, std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                                             uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    Completion completion;
+    I2C_Error_Type result = enqueue(Transaction{address, tx, rx, nullptr, &completion});
+    if (result != I2C_Error_Type::OK) {
+        return result;
+    }
+
+    while (!completion.done) {
+        poll();
+        if (deadline.expired()) {
+            cancel(completion);
+        }
+    }
+    return completion.status;
+}
+
+I2C_Error_Type I2C_Master::set_dma_threshold(size_t minimum_length) {
+    if (!running_ || busy_) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    if (minimum_length == 0) {
+        dma_threshold_ = 0;
+        return I2C_Error_Type::OK;
+    }
+
+    const I2C_DMA_Channels& channels = I2C_dma_index[static_cast<int>(i2c_.base_index_)];
+    auto dma_result = dma::DMA::get_instance(channels.dma_base);
+    if (dma_result.error() != dma::DMA_Error_Type::OK) {
+        return I2C_Error_Type::INITIALIZATION_FAILED;
+    }
+    dma_ = &dma_result.value();
+
+    dma::DMA_Config rx_config = {
+        .peripheral_address = reinterpret_cast<uint32_t>(i2c_.reg_address(I2C_Regs::DATA)),
+        .peripheral_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .memory_address = 0,
+        .memory_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .count = 0,
+        .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+        .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+        .channel_priority = dma::Channel_Priority::HIGH_PRIORITY,
+        .direction = dma::Transfer_Direction::P2M,
+    };
+    dma::DMA_Config tx_config = rx_config;
+    tx_config.channel_priority = dma::Channel_Priority::MEDIUM_PRIORITY;
+    tx_config.direction = dma::Transfer_Direction::M2P;
+
+    dma_->reset(channels.rx_channel);
+    dma_->configure(channels.rx_channel, rx_config);
+    dma_->set_interrupt_enable(channels.rx_channel, dma::Interrupt_Type::INTR_FTFIE, true);
+    dma_->set_interrupt_enable(channels.rx_channel, dma::Interrupt_Type::INTR_ERRIE, true);
+    dma_->reset(channels.tx_channel);
+    dma_->configure(channels.tx_channel, tx_config);
+    dma_->set_interrupt_enable(channels.tx_channel, dma::Interrupt_Type::INTR_FTFIE, true);
+    dma_->set_interrupt_enable(channels.tx_channel, dma::Interrupt_Type::INTR_ERRIE, true);
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channels.rx_channel));
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channels.tx_channel));
+
+    dma_threshold_ = std::max(minimum_length, MinimumDmaLength);
+    return I2C_Error_Type::OK;
+}
+
+//
+// Thread context. Besides expiring the running transaction, this is where a
+// bus that start_next() found stuck is clocked free: busy_ is held for the
+// duration so nothing is started underneath the recovery.
+//
+void I2C_Master::poll() {
+    bool expired = false;
+    {
+        cortex::Critical_Section section;
+        if (active_ && deadline_.expired() && take_active()) {
+            expired = true;
+        } else if (busy_ || !recovery_needed_) {
+            return;
+        } else {
+            busy_ = true;
+        }
+    }
+    if (expired) {
+        timeouts_ = timeouts_ + 1;
+        i2c_.generate_stop_condition();
+        queue_.finish(I2C_Error_Type::TIMEOUT);
+    }
+    restart();
+}
+
+I2C_Error_Type I2C_Master::recover_bus() {
+    if (busy_ || (scl_port_ == nullptr)) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    recovery_needed_ = false;
+    return recover();
+}
+
+//
+// Producers may be tasks and interrupts of any priority, the push and the
+// idle check are done with interrupts off. Only an idle bus is kicked from
+// here, otherwise the completion of the running transaction starts the next.
+//
+I2C_Error_Type I2C_Master::enqueue(const Transaction& transaction) {
+    if (!running_) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    if (transaction.address > 0x7F) {
+        return I2C_Error_Type::INVALID_SELECTION;
+    }
+
+    bool kick = false;
+    {
+        cortex::Critical_Section section;
+        if (!queue_.push(transaction)) {
+            return I2C_Error_Type::INVALID_OPERATION;
+        }
+        if (!busy_) {
+            busy_ = true;
+            kick = true;
+        }
+    }
+    if (kick) {
+        start_next();
+    }
+    return I2C_Error_Type::OK;
+}
+
+//
+// A blocking transfer ran out of time. If its transaction holds the bus it is
+// ended with a STOP, and since this is task context a bus left busy is
+// recovered straight away; a transaction still queued is discarded.
+//
+void I2C_Master::cancel(Completion& completion) {
+    {
+        cortex::Critical_Section section;
+        if (completion.done) {
+            return;
+        }
+        if (!active_ || !queue_.is_front(completion) || !take_active()) {
+            queue_.discard(completion, I2C_Error_Type::TIMEOUT);
+            return;
+        }
+    }
+    i2c_.generate_stop_condition();
+    queue_.finish(I2C_Error_Type::TIMEOUT);
+    restart();
+}
+
+// Thread context with busy_ held: waits out the STOP, recovers if needed
+void I2C_Master::restart() {
+    if (!wait_bus_free()) {
+        recover();
+    }
+    recovery_needed_ = false;
+    start_next();
+}
+
+//
+// Runs in whichever context owns busy_, often the EV or ER interrupt, so it
+// never waits on the bus. START may be set while the previous STOP is still
+// going out; the peripheral generates it once the bus is free and SBSEND
+// carries on from there. A bus that is busy with no STOP of ours pending is
+// stuck: everything queued at that point completes with BUS_ERROR, one after
+// another rather than recursively, and poll() recovers it later.
+//
+void I2C_Master::start_next() {
+    for (;;) {
+        {
+            cortex::Critical_Section section;
+            if (!queue_.skip_discarded()) {
+                busy_ = false;
+                return;
+            }
+        }
+
+        if (bus_stuck()) {
+            recovery_needed_ = true;
+            for (size_t count = queue_.size(); count != 0; --count) {
+                queue_.finish(I2C_Error_Type::BUS_ERROR);
+            }
+            continue;
+        }
+
+        const Transaction& transaction = queue_.front();
+        index_ = 0;
+        rx_length_ = transaction.rx.size();
+        phase_ = (transaction.tx.empty() && !transaction.rx.empty()) ? Phase::READ : Phase::WRITE;
+        i2c_.set_ack_position(ACK_Select::CURRENT);
+        i2c_.set_ack_enable(true);
+        // Turning PECEN off restarts the PEC, which then covers the addresses too
+        write_bits(i2c_, I2C_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::PECEN), Clear,
+                   static_cast<uint32_t>(CTL0_Bits::PECTRANS), Clear);
+        if (transaction.pec) {
+            i2c_.set_pec_calculate(true);
+        }
+
+        // A blocking caller may have given up while the registers were set up
+        cortex::Critical_Section section;
+        if (queue_.is_discarded(transaction)) {
+            continue;
+        }
+        deadline_ = cortex::Deadline(timeout_cycles_);
+        pec_error_ = false;
+        active_ = true;
+        set_events_enable(true);
+        i2c_.generate_start_condition();
+        return;
+    }
+}
+
+bool I2C_Master::wait_bus_free() {
+    const cortex::Deadline deadline(half_period_cycles_ * BusFreeHalfPeriods);
+    while (((read_register<uint32_t>(i2c_, I2C_Regs::CTL0) & bit_mask(CTL0_Bits::STOP)) != 0) ||
+            ((read_register<uint32_t>(i2c_, I2C_Regs::STAT1) & bit_mask(STAT1_Bits::I2CBSY)) != 0)) {
+        if (deadline.expired()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Single master assumed, so a busy bus we are not driving is held by a slave
+bool I2C_Master::bus_stuck() const {
+    const uint32_t stat1 = read_register<uint32_t>(i2c_, I2C_Regs::STAT1);
+    return ((stat1 & bit_mask(STAT1_Bits::I2CBSY)) != 0) &&
+           ((stat1 & bit_mask(STAT1_Bits::MASTER)) == 0) &&
+           ((read_register<uint32_t>(i2c_, I2C_Regs::CTL0) & bit_mask(CTL0_Bits::STOP)) == 0);
+}
+
+//
+// Called with interrupts off. Takes the front transaction away from the
+// interrupt handlers; whoever succeeds finishes it with retire().
+//
+bool I2C_Master::take_active() {
+    if (!active_) {
+        return false;
+    }
+    active_ = false;
+    set_events_enable(false);
+    stop_dma();
+    return true;
+}
+
+void I2C_Master::abort(I2C_Error_Type status) {
+    {
+        cortex::Critical_Section section;
+        if (!take_active()) {
+            return;
+        }
+    }
+    // A bus that stays stuck expires the next transaction, poll() recovers it
+    i2c_.generate_stop_condition();
+    retire(status);
+}
+
+void I2C_Master::complete(I2C_Error_Type status) {
+    {
+        cortex::Critical_Section section;
+        if (!take_active()) {
+            return;
+        }
+    }
+    retire(status);
+}
+
+// busy_ stays set, so transactions submitted from the callback are only queued
+void I2C_Master::retire(I2C_Error_Type status) {
+    queue_.finish(status);
+    start_next();
+}
+
+void I2C_Master::set_events_enable(bool enable) {
+    write_bits(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::EVIE), enable ? Set : Clear,
+               static_cast<uint32_t>(CTL1_Bits::BUFIE), enable ? Set : Clear);
+}
+
+void I2C_Master::handle_event_interrupt() {
+    if (!active_) {
+        return;
+    }
+    const uint32_t stat0 = read_register<uint32_t>(i2c_, I2C_Regs::STAT0);
+    const Transaction& transaction = queue_.front();
+
+    if ((stat0 & bit_mask(STAT0_Bits::SBSEND)) != 0) {
+        // The STAT0 read above and this DATA write clear SBSEND
+        const uint32_t direction = (phase_ == Phase::READ) ? 1U : 0U;
+        write_register(i2c_, I2C_Regs::DATA, (static_cast<uint32_t>(transaction.address) << 1) | direction);
+        return;
+    }
+
+    if ((stat0 & bit_mask(STAT0_Bits::ADDSEND)) != 0) {
+        if (phase_ == Phase::WRITE) {
+            if (!transaction.pec && use_dma(transaction.tx.size())) {
+                start_dma_phase(false, reinterpret_cast<uint32_t>(transaction.tx.data()), transaction.tx.size());
+            }
+            i2c_.clear_flag(Clear_Flags::FLAG_ADDSEND);
+            if (transaction.tx.empty()) {
+                // Address probe
+                i2c_.generate_stop_condition();
+                complete(I2C_Error_Type::OK);
+            }
+            return;
+        }
+        // ACKEN and POAP are only sampled for the first byte while ADDSEND is set
+        const size_t count = rx_length_;
+        if (!transaction.pec && !transaction.block_read && use_dma(count)) {
+            start_dma_phase(true, reinterpret_cast<uint32_t>(transaction.rx.data()), count);
+            i2c_.clear_flag(Clear_Flags::FLAG_ADDSEND);
+        } else if (count == 1) {
+            nack_next(transaction);
+            cortex::Critical_Section section;
+            i2c_.clear_flag(Clear_Flags::FLAG_ADDSEND);
+            i2c_.generate_stop_condition();
+        } else if (count == 2) {
+            i2c_.set_ack_position(ACK_Select::NEXT);
+            nack_next(transaction);
+            i2c_.clear_flag(Clear_Flags::FLAG_ADDSEND);
+            i2c_.set_interrupt_enable(Interrupt_Type::INTR_BUF, false);
+        } else {
+            i2c_.clear_flag(Clear_Flags::FLAG_ADDSEND);
+            if (count == 3) {
+                i2c_.set_interrupt_enable(Interrupt_Type::INTR_BUF, false);
+            }
+        }
+        return;
+    }
+
+    if (phase_ == Phase::READ) {
+        read_phase(stat0, transaction);
+        return;
+    }
+
+    if (index_ < transaction.tx.size()) {
+        if ((stat0 & bit_mask(STAT0_Bits::TBE)) != 0) {
+            write_register(i2c_, I2C_Regs::DATA, static_cast<uint32_t>(transaction.tx[index_]));
+            index_ = index_ + 1;
+            if (index_ == transaction.tx.size()) {
+                // The end of the last byte is signalled by BTC
+                i2c_.set_interrupt_enable(Interrupt_Type::INTR_BUF, false);
+                if (transaction.pec && transaction.rx.empty()) {
+                    // The PEC goes out after the byte just loaded
+                    i2c_.set_pec_transfer_enable(true);
+                }
+            }
+        }
+        return;
+    }
+    if ((stat0 & bit_mask(STAT0_Bits::BTC)) != 0) {
+        if (!transaction.rx.empty()) {
+            // Repeated start, clears BTC
+            phase_ = Phase::READ;
+            index_ = 0;
+            rx_length_ = transaction.rx.size();
+            i2c_.set_interrupt_enable(Interrupt_Type::INTR_BUF, true);
+            i2c_.generate_start_condition();
+        } else {
+            i2c_.generate_stop_condition();
+            complete(I2C_Error_Type::OK);
+        }
+    }
+}
+
+//
+// Bytes are taken on RBNE until three are left. From there BTC is used:
+// with byte N-2 in DATA and N-1 in the shift register, ACKEN is cleared so
+// the NACK goes out with byte N, and with N-1 and N both held STOP is set
+// before they are read. Two byte reads set POAP instead and only take the
+// final step; a one byte read set STOP when ADDSEND was cleared.
+//
+// A block read learns its length from the first byte while the second is
+// being received, and joins the sequence above at the matching step.
+//
+void I2C_Master::read_phase(uint32_t stat0, const Transaction& transaction) {
+    const size_t remaining = rx_length_ - index_;
+    const bool btc = (stat0 & bit_mask(STAT0_Bits::BTC)) != 0;
+
+    if (remaining > 3) {
+        if ((stat0 & bit_mask(STAT0_Bits::RBNE)) != 0) {
+            transaction.rx[index_] = static_cast<uint8_t>(read_register<uint32_t>(i2c_, I2C_Regs::DATA));
+            index_ = index_ + 1;
+            if (transaction.block_read && (index_ == 1)) {
+                set_block_length(transaction);
+            } else if ((remaining - 1) == 3) {
+                i2c_.set_interrupt_enable(Interrupt_Type::INTR_BUF, false);
+            }
+        }
+    } else if (remaining == 3) {
+        if (btc) {
+            nack_next(transaction);
+            transaction.rx[index_] = static_cast<uint8_t>(read_register<uint32_t>(i2c_, I2C_Regs::DATA));
+            index_ = index_ + 1;
+        }
+    } else if (remaining == 2) {
+        if (btc) {
+            {
+                cortex::Critical_Section section;
+                i2c_.generate_stop_condition();
+                transaction.rx[index_] = static_cast<uint8_t>(read_register<uint32_t>(i2c_, I2C_Regs::DATA));
+            }
+            transaction.rx[index_ + 1] = static_cast<uint8_t>(read_register<uint32_t>(i2c_, I2C_Regs::DATA));
+            index_ = index_ + 2;
+            complete(read_status(transaction));
+        }
+    } else if ((stat0 & bit_mask(STAT0_Bits::RBNE)) != 0) {
+        transaction.rx[index_] = static_cast<uint8_t>(read_register<uint32_t>(i2c_, I2C_Regs::DATA));
+        index_ = index_ + 1;
+        complete(read_status(transaction));
+    }
+}
+
+//
+// The count byte has been read and the next byte is in the shift register,
+// not yet acknowledged. A count of zero still clocks that byte, and a count
+// larger than the buffer is cut short; the caller checks rx[0].
+//
+void I2C_Master::set_block_length(const Transaction& transaction) {
+    const size_t pec_length = transaction.pec ? 1 : 0;
+    size_t length = 1 + static_cast<size_t>(transaction.rx[0]) + pec_length;
+    length = std::clamp(length, size_t{2}, transaction.rx.size());
+    rx_length_ = length;
+
+    const size_t remaining = length - 1;
+    if (remaining == 1) {
+        nack_next(transaction);
+        cortex::Critical_Section section;
+        i2c_.generate_stop_condition();
+    } else if (remaining == 2) {
+        i2c_.set_ack_position(ACK_Select::NEXT);
+        nack_next(transaction);
+        i2c_.set_interrupt_enable(Interrupt_Type::INTR_BUF, false);
+    } else if (remaining == 3) {
+        i2c_.set_interrupt_enable(Interrupt_Type::INTR_BUF, false);
+    }
+}
+
+// With PEC the NACKed byte is the PEC, checked by the hardware
+void I2C_Master::nack_next(const Transaction& transaction) {
+    i2c_.set_ack_enable(false);
+    if (transaction.pec) {
+        i2c_.set_pec_transfer_enable(true);
+    }
+}
+
+//
+// The error interrupt may have run first and cleared PECERR, in which case
+// it left the mismatch in pec_error_.
+//
+I2C_Error_Type I2C_Master::read_status(const Transaction& transaction) {
+    if ((read_register<uint32_t>(i2c_, I2C_Regs::STAT0) & bit_mask(STAT0_Bits::PECERR)) != 0) {
+        write_register(i2c_, I2C_Regs::STAT0, ~bit_mask(STAT0_Bits::PECERR) & 0xFFFFU);
+        pec_error_ = true;
+    }
+    const bool mismatch = pec_error_;
+    pec_error_ = false;
+    return (transaction.pec && mismatch) ? I2C_Error_Type::PEC_ERROR : I2C_Error_Type::OK;
+}
+
+//
+// The channel goes in before ADDSEND is cleared, while SCL is stretched.
+// Event and buffer interrupts stay off until the channel finishes.
+//
+void I2C_Master::start_dma_phase(bool receive, uint32_t memory_address, size_t length) {
+    const I2C_DMA_Channels& channels = I2C_dma_index[static_cast<int>(i2c_.base_index_)];
+    const dma::DMA_Channel channel = receive ? channels.rx_channel : channels.tx_channel;
+
+    dma_->set_channel_enable(channel, false);
+    dma_->clear_flags(dma::channel_all_flags_mask(channel));
+    dma_->set_data_address(channel, dma::Data_Type::MEMORY_ADDRESS, memory_address);
+    dma_->set_transfer_count(channel, static_cast<uint32_t>(length));
+    dma_->set_channel_enable(channel, true);
+
+    dma_phase_ = true;
+    set_events_enable(false);
+    write_bits(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::DMALST), receive ? Set : Clear,
+               static_cast<uint32_t>(CTL1_Bits::DMAON), Set);
+}
+
+void I2C_Master::stop_dma() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    const I2C_DMA_Channels& channels = I2C_dma_index[static_cast<int>(i2c_.base_index_)];
+    write_bits(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::DMAON), Clear,
+               static_cast<uint32_t>(CTL1_Bits::DMALST), Clear);
+    dma_->set_channel_enable(channels.rx_channel, false);
+    dma_->set_channel_enable(channels.tx_channel, false);
+    dma_phase_ = false;
+}
+
+void I2C_Master::handle_dma_interrupt() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    const I2C_DMA_Channels& channels = I2C_dma_index[static_cast<int>(i2c_.base_index_)];
+    const uint32_t channel_mask = (1U << static_cast<uint32_t>(channels.rx_channel)) |
+                                  (1U << static_cast<uint32_t>(channels.tx_channel));
+    const dma::DMA_Status_Snapshot status = dma_->get_interrupt_snapshot(channel_mask);
+    dma_->clear_flags(status.flags);
+
+    if (!active_ || !dma_phase_) {
+        return;
+    }
+    if (status.test(channels.rx_channel, dma::Status_Flags::FLAG_ERRIF) ||
+            status.test(channels.tx_channel, dma::Status_Flags::FLAG_ERRIF)) {
+        abort(I2C_Error_Type::DMA_TRANSFER_ERROR);
+        return;
+    }
+
+    const Transaction& transaction = queue_.front();
+    if ((phase_ == Phase::READ) && status.test(channels.rx_channel, dma::Status_Flags::FLAG_FTFIF)) {
+        // The last byte has been NACKed and the master holds SCL low
+        i2c_.generate_stop_condition();
+        index_ = transaction.rx.size();
+        complete(I2C_Error_Type::OK);
+    } else if ((phase_ == Phase::WRITE) && status.test(channels.tx_channel, dma::Status_Flags::FLAG_FTFIF)) {
+        // The last byte is still in DATA or the shift register, BTC takes it from here
+        stop_dma();
+        index_ = transaction.tx.size();
+        write_bit(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::EVIE), Set);
+    }
+}
+
+void I2C_Master::handle_error_interrupt() {
+    const uint32_t errors = read_register<uint32_t>(i2c_, I2C_Regs::STAT0) & ErrorFlags;
+    if (errors == 0) {
+        return;
+    }
+    // The error flags clear on a zero write, ones leave the other flags alone.
+    // PECERR is latched for read_status(), the read itself still completes.
+    write_register(i2c_, I2C_Regs::STAT0, ~errors & 0xFFFFU);
+    if ((errors & bit_mask(STAT0_Bits::PECERR)) != 0) {
+        pec_error_ = true;
+    }
+
+    if (((errors & bit_mask(STAT0_Bits::SMBALT)) != 0) && alert_callback_) {
+        alert_callback_();
+    }
+    if (!active_) {
+        return;
+    }
+    if ((errors & bit_mask(STAT0_Bits::LOSTARB)) != 0) {
+        // The peripheral has already dropped back to slave mode
+        complete(I2C_Error_Type::ARBITRATION_LOST);
+    } else if ((errors & bit_mask(STAT0_Bits::AERR)) != 0) {
+        i2c_.generate_stop_condition();
+        complete(I2C_Error_Type::NACK);
+    } else if ((errors & bit_mask(STAT0_Bits::BERR)) != 0) {
+        abort(I2C_Error_Type::BUS_ERROR);
+    } else if ((errors & bit_mask(STAT0_Bits::SMBTO)) != 0) {
+        abort(I2C_Error_Type::TIMEOUT);
+    }
+}
+
+//
+// The pins are taken over as open-drain outputs and SCL is pulsed until the
+// slave lets go of SDA, at most nine times, then a STOP is driven. The
+// peripheral still believes the bus is busy, so it gets a software reset
+// and its configuration written back.
+//
+I2C_Error_Type I2C_Master::recover() {
+    const I2C_Pins& pins = i2c_.get_pins_config();
+    volatile uint32_t *scl_high = scl_port_->reg_address(gpio::GPIO_Regs::BOP);
+    volatile uint32_t *scl_low = scl_port_->reg_address(gpio::GPIO_Regs::BC);
+    volatile uint32_t *sda_high = sda_port_->reg_address(gpio::GPIO_Regs::BOP);
+    volatile uint32_t *sda_low = sda_port_->reg_address(gpio::GPIO_Regs::BC);
+    volatile uint32_t *scl_input = scl_port_->reg_address(gpio::GPIO_Regs::ISTAT);
+    volatile uint32_t *sda_input = sda_port_->reg_address(gpio::GPIO_Regs::ISTAT);
+
+    // Released before the pins leave the peripheral
+    *scl_high = scl_mask_;
+    *sda_high = sda_mask_;
+    scl_port_->init_pin(pins.scl_pin.pin, gpio::Pin_Mode::OUTPUT_OPENDRAIN, pins.scl_pin.speed);
+    sda_port_->init_pin(pins.sda_pin.pin, gpio::Pin_Mode::OUTPUT_OPENDRAIN, pins.sda_pin.speed);
+
+    for (uint32_t pulse = 0; (pulse < RecoveryClockPulses) && ((*sda_input & sda_mask_) == 0); ++pulse) {
+        *scl_low = scl_mask_;
+        delay_half_period();
+        *scl_high = scl_mask_;
+        // The slave may stretch the clock
+        const cortex::Deadline stretch(half_period_cycles_ * BusFreeHalfPeriods);
+        while (((*scl_input & scl_mask_) == 0) && !stretch.expired()) {
+        }
+        delay_half_period();
+    }
+
+    // STOP: SDA rises while SCL is high
+    *scl_low = scl_mask_;
+    delay_half_period();
+    *sda_low = sda_mask_;
+    delay_half_period();
+    *scl_high = scl_mask_;
+    delay_half_period();
+    *sda_high = sda_mask_;
+    delay_half_period();
+    const bool released = ((*sda_input & sda_mask_) != 0) && ((*scl_input & scl_mask_) != 0);
+
+    scl_port_->init_pin(pins.scl_pin.pin, pins.scl_pin.mode, pins.scl_pin.speed);
+    sda_port_->init_pin(pins.sda_pin.pin, pins.sda_pin.mode, pins.sda_pin.speed);
+
+    const uint32_t ctl0 = read_register<uint32_t>(i2c_, I2C_Regs::CTL0) &
+                          ~(bit_mask(CTL0_Bits::START) | bit_mask(CTL0_Bits::STOP) | bit_mask(CTL0_Bits::POAP) |
+                            bit_mask(CTL0_Bits::PECTRANS) | bit_mask(CTL0_Bits::SRESET));
+    const uint32_t ctl1 = read_register<uint32_t>(i2c_, I2C_Regs::CTL1);
+    const uint32_t saddr0 = read_register<uint32_t>(i2c_, I2C_Regs::SADDR0);
+    const uint32_t saddr1 = read_register<uint32_t>(i2c_, I2C_Regs::SADDR1);
+    const uint32_t ckcfg = read_register<uint32_t>(i2c_, I2C_Regs::CKCFG);
+    const uint32_t rt = read_register<uint32_t>(i2c_, I2C_Regs::RT);
+    i2c_.set_software_reset_enable(true);
+    i2c_.set_software_reset_enable(false);
+    write_register(i2c_, I2C_Regs::CTL1, ctl1);
+    write_register(i2c_, I2C_Regs::SADDR0, saddr0);
+    write_register(i2c_, I2C_Regs::SADDR1, saddr1);
+    write_register(i2c_, I2C_Regs::CKCFG, ckcfg);
+    write_register(i2c_, I2C_Regs::RT, rt);
+    write_register(i2c_, I2C_Regs::CTL0, ctl0);
+
+    recoveries_ = recoveries_ + 1;
+    return released ? I2C_Error_Type::OK : I2C_Error_Type::BUS_ERROR;
+}
+
+void I2C_Master::delay_half_period() const {
+    const cortex::Deadline deadline(half_period_cycles_);
+    while (!deadline.expired()) {
+    }
+}
+
+} // namespace i2c
@@ -0,0 +1,198 @@
+// gd32f30x I2C interrupt driven master in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "DMA.hpp"
+#include "TransactionQueue.hpp"
+#include "I2C.hpp"
+
+namespace i2c {
+
+//
+// Queued master transactions run entirely from the event and error
+// interrupts: write, read, and write-then-read with a repeated start, all to
+// 7-bit addresses. Receive follows the GD32 ordering rules, ACKEN and POAP
+// are set up before ADDSEND is cleared and the last two bytes are taken on
+// BTC, so the NACK and STOP land on the right byte for any length. A
+// transaction with no data is an address probe.
+//
+// Every transaction gets a deadline from begin(); poll() or a blocking
+// transfer expires it. The interrupt handlers never wait on the bus. One
+// found busy with no STOP pending, on the assumption of a single master, is
+// treated as stuck: everything queued at that point completes with BUS_ERROR
+// and the next poll() recovers it with up to nine SCL pulses on the GPIO
+// pins followed by a STOP and a software reset of the peripheral. Callbacks
+// run outside critical sections, in interrupt context when the transaction
+// finished there.
+//
+// With a DMA threshold set, data phases of that many bytes or more move by
+// DMA and cost two interrupts instead of one per byte. Writes wait for BTC
+// after the channel finishes so the last byte is on the wire before STOP or
+// the repeated start. Reads set DMALST, so the byte that ends the channel
+// is the one the hardware NACKs, and STOP follows the channel's completion.
+//
+// Transactions submitted with pec set have the PEC computed by the
+// hardware over the whole transaction: appended after the last byte of a
+// write, and for a read taken as the last rx byte and checked, with a
+// mismatch completing as PEC_ERROR. A block_read takes its length from the
+// first byte received (SMBus block count). Neither uses DMA. SMBALERT and
+// SMBus timeouts are reported through the error interrupt.
+//
+// The I2C must be configured (clock, pins) beforehand. The application
+// forwards I2Cx_EV_IRQHandler and I2Cx_ER_IRQHandler, which should share a
+// high priority: the one byte read clears ADDSEND and sets STOP back to back.
+// The DMA channel interrupts, when used, go to handle_dma_interrupt() at the
+// same priority.
+//
+class I2C_Master {
+public:
+    using Transaction_Callback = std::function<void(I2C_Error_Type status)>;
+    using Alert_Callback = std::function<void()>;
+
+    // Pulse rate used by the recovery sequence
+    static constexpr uint32_t RecoveryClockFrequency = 100'000;
+    static constexpr uint32_t RecoveryClockPulses = 9;
+    // DMALST needs at least two bytes to place the NACK
+    static constexpr size_t MinimumDmaLength = 2;
+    static constexpr size_t MaximumDmaLength = 0xFFFF;
+    // Block reads start out on the N > 3 path until the count is known
+    static constexpr size_t MinimumBlockReadLength = 4;
+
+    using Completion = ::Completion<I2C_Error_Type>;
+
+    struct Transaction {
+        uint8_t address;
+        std::span<const uint8_t> tx;
+        std::span<uint8_t> rx;
+        Transaction_Callback callback;
+        Completion* completion;
+        bool pec = false;
+        bool block_read = false;
+    };
+
+    explicit I2C_Master(I2C& i2c) : i2c_(i2c) {}
+
+    // Queue storage size must be a power of two
+    I2C_Error_Type begin(std::span<Transaction> queue_storage, uint32_t timeout_cycles);
+    void end();
+
+    // Buffers must stay valid until the callback runs
+    I2C_Error_Type submit(uint8_t address, std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                          Transaction_Callback callback = nullptr);
+    // Full control over the options, completion is ignored
+    I2C_Error_Type submit(const Transaction& transaction);
+    I2C_Error_Type write(uint8_t address, std::span<const uint8_t> tx, Transaction_Callback callback = nullptr) {
+        return submit(address, tx, std::span<uint8_t>(), callback);
+    }
+    I2C_Error_Type read(uint8_t address, std::span<uint8_t> rx, Transaction_Callback callback = nullptr) {
+        return submit(address, std::span<const uint8_t>(), rx, callback);
+    }
+    I2C_Error_Type write_read(uint8_t address, std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                              Transaction_Callback callback = nullptr) {
+        return submit(address, tx, rx, callback);
+    }
+    // Task context only, queued behind whatever is pending. Any number of
+    // tasks may block at once, each waits for its own transaction.
+    I2C_Error_Type transfer_blocking(uint8_t address, std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                                     uint32_t timeout_cycles = cortex::Deadline::Infinite);
+
+    // Data phases of at least minimum_length bytes use DMA, 0 turns DMA off.
+    // Only while idle.
+    I2C_Error_Type set_dma_threshold(size_t minimum_length);
+
+    // SMBALERT asserted, runs in the error interrupt. Needs SALT set.
+    void set_alert_callback(Alert_Callback callback) {
+        alert_callback_ = callback;
+    }
+
+    // Expires a transaction that outlived its deadline and recovers a stuck
+    // bus. Call periodically from task context.
+    void poll();
+    // Clocks a slave out of a stuck read, the bus must be idle
+    I2C_Error_Type recover_bus();
+
+    bool is_idle() const {
+        return !busy_;
+    }
+    size_t queued() const {
+        return queue_.size();
+    }
+    uint32_t get_recovery_count() const {
+        return recoveries_;
+    }
+    uint32_t get_timeout_count() const {
+        return timeouts_;
+    }
+
+    // Call from I2Cx_EV_IRQHandler and I2Cx_ER_IRQHandler
+    void handle_event_interrupt();
+    void handle_error_interrupt();
+    // Call from the IRQ handlers of both the TX and RX DMA channels
+    void handle_dma_interrupt();
+
+private:
+    enum class Phase {
+        WRITE,
+        READ,
+    };
+
+    I2C& i2c_;
+    gpio::GPIO* scl_port_ = nullptr;
+    gpio::GPIO* sda_port_ = nullptr;
+    uint32_t scl_mask_ = 0;
+    uint32_t sda_mask_ = 0;
+    uint32_t half_period_cycles_ = 0;
+    dma::DMA* dma_ = nullptr;
+    size_t dma_threshold_ = 0;
+    bool dma_phase_ = false;
+
+    Transaction_Queue<Transaction, I2C_Error_Type> queue_;
+    // busy_ is ownership of the queue, active_ that the front transaction is on the bus
+    volatile bool busy_ = false;
+    volatile bool active_ = false;
+    bool running_ = false;
+    Phase phase_ = Phase::WRITE;
+    size_t index_ = 0;
+    size_t rx_length_ = 0;
+    Alert_Callback alert_callback_;
+    uint32_t timeout_cycles_ = cortex::Deadline::Infinite;
+    cortex::Deadline deadline_{cortex::Deadline::Infinite};
+    // PECERR seen by either handler for the running transaction
+    volatile bool pec_error_ = false;
+    // Set by start_next() on a stuck bus, poll() does the recovery
+    volatile bool recovery_needed_ = false;
+    volatile uint32_t recoveries_ = 0;
+    volatile uint32_t timeouts_ = 0;
+
+    I2C_Error_Type enqueue(const Transaction& transaction);
+    void cancel(Completion& completion);
+    void start_next();
+    void restart();
+    bool wait_bus_free();
+    bool bus_stuck() const;
+    bool take_active();
+    void abort(I2C_Error_Type status);
+    void complete(I2C_Error_Type status);
+    void retire(I2C_Error_Type status);
+    void set_events_enable(bool enable);
+    void read_phase(uint32_t stat0, const Transaction& transaction);
+    void set_block_length(const Transaction& transaction);
+    void nack_next(const Transaction& transaction);
+    I2C_Error_Type read_status(const Transaction& transaction);
+    I2C_Error_Type recover();
+    bool use_dma(size_t length) const {
+        return (dma_threshold_ != 0) && (length >= dma_threshold_) && (length <= MaximumDmaLength);
+    }
+    void start_dma_phase(bool receive, uint32_t memory_address, size_t length);
+    void stop_dma();
+    void delay_half_period() const;
+};
+
+} // namespace i2c
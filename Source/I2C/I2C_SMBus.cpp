@@ -0,0 +1,279 @@
+// gd32f30x SMBus host in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <algorithm>
+
+#include "I2C_SMBus.hpp"
+
+namespace i2c {
+
+I2C_Error_Type SMBus::begin(bool pec, Alert_Handler alert_handler) {
+    if (busy_) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    pec_ = pec;
+    alert_handler_ = alert_handler;
+    alert_active_ = false;
+    alerts_ = 0;
+    pec_errors_ = 0;
+
+    // SMBEN alone, the own address in SADDR0 is left as it is
+    write_bit(i2c_, I2C_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::SMBEN), Set);
+    i2c_.set_smbus_type(Bus_Type::HOST);
+    i2c_.set_smbus_arp_enable(false);
+    if (alert_handler_) {
+        master_.set_alert_callback([this]() {
+            on_alert();
+        });
+    } else {
+        master_.set_alert_callback(nullptr);
+    }
+    i2c_.set_smbus_alert_enable(alert_handler_ != nullptr);
+
+    running_ = true;
+    return I2C_Error_Type::OK;
+}
+
+void SMBus::end() {
+    running_ = false;
+    i2c_.set_smbus_alert_enable(false);
+    master_.set_alert_callback(nullptr);
+    write_bit(i2c_, I2C_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::SMBEN), Clear);
+    alert_active_ = false;
+}
+
+I2C_Error_Type SMBus::quick_command(uint8_t address, Command_Callback callback) {
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    return start(address, 0, 0, Result_Type::NONE, callback);
+}
+
+I2C_Error_Type SMBus::send_byte(uint8_t address, uint8_t value, Command_Callback callback) {
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    tx_[0] = value;
+    return start(address, 1, 0, Result_Type::NONE, callback);
+}
+
+I2C_Error_Type SMBus::receive_byte(uint8_t address, uint8_t& value, Command_Callback callback) {
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    byte_result_ = &value;
+    return start(address, 0, 1, Result_Type::BYTE, callback);
+}
+
+I2C_Error_Type SMBus::write_byte(uint8_t address, uint8_t command, uint8_t value, Command_Callback callback) {
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    tx_[0] = command;
+    tx_[1] = value;
+    return start(address, 2, 0, Result_Type::NONE, callback);
+}
+
+I2C_Error_Type SMBus::write_word(uint8_t address, uint8_t command, uint16_t value, Command_Callback callback) {
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    tx_[0] = command;
+    tx_[1] = static_cast<uint8_t>(value);
+    tx_[2] = static_cast<uint8_t>(value >> 8);
+    return start(address, 3, 0, Result_Type::NONE, callback);
+}
+
+I2C_Error_Type SMBus::read_byte(uint8_t address, uint8_t command, uint8_t& value, Command_Callback callback) {
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    tx_[0] = command;
+    byte_result_ = &value;
+    return start(address, 1, 1, Result_Type::BYTE, callback);
+}
+
+I2C_Error_Type SMBus::read_word(uint8_t address, uint8_t command, uint16_t& value, Command_Callback callback) {
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    tx_[0] = command;
+    word_result_ = &value;
+    return start(address, 1, 2, Result_Type::WORD, callback);
+}
+
+I2C_Error_Type SMBus::process_call(uint8_t address, uint8_t command, uint16_t value, uint16_t& result,
+                                   Command_Callback callback) {
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    tx_[0] = command;
+    tx_[1] = static_cast<uint8_t>(value);
+    tx_[2] = static_cast<uint8_t>(value >> 8);
+    word_result_ = &result;
+    return start(address, 3, 2, Result_Type::WORD, callback);
+}
+
+I2C_Error_Type SMBus::block_write(uint8_t address, uint8_t command, std::span<const uint8_t> data,
+                                  Command_Callback callback) {
+    if (data.empty() || (data.size() > MaximumBlockSize)) {
+        return I2C_Error_Type::INVALID_SELECTION;
+    }
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    tx_[0] = command;
+    tx_[1] = static_cast<uint8_t>(data.size());
+    std::copy(data.begin(), data.end(), tx_.begin() + 2);
+    return start(address, data.size() + 2, 0, Result_Type::NONE, callback);
+}
+
+I2C_Error_Type SMBus::block_read(uint8_t address, uint8_t command, std::span<uint8_t> data, size_t& length,
+                                 Command_Callback callback) {
+    if (data.empty()) {
+        return I2C_Error_Type::INVALID_SELECTION;
+    }
+    if (!claim()) {
+        return I2C_Error_Type::INVALID_OPERATION;
+    }
+    tx_[0] = command;
+    block_result_ = data;
+    length_result_ = &length;
+    // The master cuts the read short once the count byte is in
+    return start(address, 1, MaximumBlockSize + 1, Result_Type::BLOCK, callback);
+}
+
+I2C_Error_Type SMBus::wait() {
+    while (busy_) {
+        master_.poll();
+    }
+    return status_;
+}
+
+// Commands may be issued from callbacks, so the busy check is atomic
+bool SMBus::claim() {
+    cortex::Critical_Section section;
+    if (!running_ || busy_) {
+        return false;
+    }
+    busy_ = true;
+    return true;
+}
+
+//
+// rx_length counts data bytes only; with PEC the read takes one more byte,
+// which the hardware checks. A command with no data carries no PEC.
+//
+I2C_Error_Type SMBus::start(uint8_t address, size_t tx_length, size_t rx_length, Result_Type result_type,
+                            Command_Callback callback) {
+    result_type_ = result_type;
+    callback_ = callback;
+    status_ = I2C_Error_Type::OK;
+
+    const bool pec = pec_ && ((tx_length + rx_length) != 0);
+    I2C_Master::Transaction transaction = {
+        address,
+        std::span<const uint8_t>(tx_.data(), tx_length),
+        std::span<uint8_t>(rx_.data(), ((rx_length != 0) && pec) ? rx_length + 1 : rx_length),
+        [this](I2C_Error_Type status) {
+            on_complete(status);
+        },
+        nullptr,
+        pec,
+        result_type == Result_Type::BLOCK,
+    };
+    const I2C_Error_Type result = master_.submit(transaction);
+    if (result != I2C_Error_Type::OK) {
+        callback_ = nullptr;
+        busy_ = false;
+    }
+    return result;
+}
+
+void SMBus::on_complete(I2C_Error_Type status) {
+    if (status == I2C_Error_Type::OK) {
+        status = store_result();
+    } else if (status == I2C_Error_Type::PEC_ERROR) {
+        pec_errors_ = pec_errors_ + 1;
+    }
+
+    const Command_Callback callback = callback_;
+    status_ = status;
+    busy_ = false;
+    if (callback) {
+        callback(status);
+    }
+}
+
+I2C_Error_Type SMBus::store_result() {
+    switch (result_type_) {
+    case Result_Type::BYTE:
+        *byte_result_ = rx_[0];
+        break;
+    case Result_Type::WORD:
+        *word_result_ = static_cast<uint16_t>(rx_[0] | (rx_[1] << 8));
+        break;
+    case Result_Type::BLOCK: {
+        const size_t count = rx_[0];
+        if ((count == 0) || (count > MaximumBlockSize) || (count > block_result_.size())) {
+            return I2C_Error_Type::BLOCK_LENGTH_ERROR;
+        }
+        std::copy_n(rx_.begin() + 1, count, block_result_.begin());
+        *length_result_ = count;
+        break;
+    }
+    default:
+        break;
+    }
+    return I2C_Error_Type::OK;
+}
+
+// Error interrupt context, SMBALT has already been cleared
+void SMBus::on_alert() {
+    alerts_ = alerts_ + 1;
+    if (alert_active_) {
+        return;
+    }
+    alert_active_ = true;
+    alert_responses_ = 0;
+    request_alert_response();
+}
+
+void SMBus::request_alert_response() {
+    I2C_Master::Transaction transaction = {
+        AlertResponseAddress,
+        std::span<const uint8_t>(),
+        std::span<uint8_t>(alert_rx_.data(), pec_ ? 2 : 1),
+        [this](I2C_Error_Type status) {
+            on_alert_response(status);
+        },
+        nullptr,
+        pec_,
+    };
+    if (master_.submit(transaction) != I2C_Error_Type::OK) {
+        alert_active_ = false;
+    }
+}
+
+//
+// The device with the lowest address wins the ARA read and releases SMBA.
+// Others keep it asserted, so the read repeats until nobody answers.
+//
+void SMBus::on_alert_response(I2C_Error_Type status) {
+    if (status == I2C_Error_Type::OK) {
+        alert_responses_ = alert_responses_ + 1;
+        if (alert_handler_) {
+            alert_handler_(static_cast<uint8_t>(alert_rx_[0] >> 1));
+        }
+        if (alert_responses_ < MaximumAlertResponses) {
+            request_alert_response();
+            return;
+        }
+    } else if (status == I2C_Error_Type::PEC_ERROR) {
+        pec_errors_ = pec_errors_ + 1;
+    }
+    alert_active_ = false;
+}
+
+} // namespace i2c
@@ -0,0 +1,121 @@
+// gd32f30x SMBus host in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "I2C_Master.hpp"
+
+namespace i2c {
+
+//
+// SMBus host protocols on an I2C_Master: quick command, send/receive byte,
+// read/write byte and word, block read/write and process call. With PEC
+// enabled the peripheral computes it over each transaction, appends it to
+// writes and checks it on reads, so no software CRC-8 runs per byte.
+//
+// SMBALERT is taken from the SMBA pin in host mode. Each alert queues an
+// Alert Response Address read and hands the responding device's address to
+// the alert handler, which typically submits the reads that device needs;
+// the read repeats until no device answers, so nothing has to be polled
+// while the bus is quiet. ARP is not implemented and stays off.
+//
+// Commands run in the background through the master, one at a time; wait()
+// turns any of them into a blocking call. Result references must stay valid
+// until the callback, which runs in interrupt context like the alert handler.
+// Quick command is the write form only, a read address always clocks a byte.
+//
+class SMBus {
+public:
+    using Command_Callback = std::function<void(I2C_Error_Type status)>;
+    using Alert_Handler = std::function<void(uint8_t address)>;
+
+    static constexpr uint8_t AlertResponseAddress = 0x0C;
+    static constexpr size_t MaximumBlockSize = 32;
+    // Devices served per alert before the line is left to signal again
+    static constexpr uint32_t MaximumAlertResponses = 8;
+
+    SMBus(I2C& i2c, I2C_Master& master) : i2c_(i2c), master_(master) {}
+
+    // The master must be running. With an alert handler the SMBA pin must
+    // already be configured.
+    I2C_Error_Type begin(bool pec, Alert_Handler alert_handler = nullptr);
+    void end();
+
+    I2C_Error_Type quick_command(uint8_t address, Command_Callback callback = nullptr);
+    I2C_Error_Type send_byte(uint8_t address, uint8_t value, Command_Callback callback = nullptr);
+    I2C_Error_Type receive_byte(uint8_t address, uint8_t& value, Command_Callback callback = nullptr);
+    I2C_Error_Type write_byte(uint8_t address, uint8_t command, uint8_t value, Command_Callback callback = nullptr);
+    I2C_Error_Type write_word(uint8_t address, uint8_t command, uint16_t value, Command_Callback callback = nullptr);
+    I2C_Error_Type read_byte(uint8_t address, uint8_t command, uint8_t& value, Command_Callback callback = nullptr);
+    I2C_Error_Type read_word(uint8_t address, uint8_t command, uint16_t& value, Command_Callback callback = nullptr);
+    I2C_Error_Type process_call(uint8_t address, uint8_t command, uint16_t value, uint16_t& result,
+                                Command_Callback callback = nullptr);
+    I2C_Error_Type block_write(uint8_t address, uint8_t command, std::span<const uint8_t> data,
+                               Command_Callback callback = nullptr);
+    // length receives the device's byte count, at most data.size()
+    I2C_Error_Type block_read(uint8_t address, uint8_t command, std::span<uint8_t> data, size_t& length,
+                              Command_Callback callback = nullptr);
+
+    // Blocks until the running command completes, returns its status
+    I2C_Error_Type wait();
+
+    bool is_busy() const {
+        return busy_;
+    }
+    uint32_t get_alert_count() const {
+        return alerts_;
+    }
+    uint32_t get_pec_error_count() const {
+        return pec_errors_;
+    }
+
+private:
+    enum class Result_Type {
+        NONE,
+        BYTE,
+        WORD,
+        BLOCK,
+    };
+
+    I2C& i2c_;
+    I2C_Master& master_;
+    bool running_ = false;
+    bool pec_ = false;
+
+    std::array<uint8_t, MaximumBlockSize + 2> tx_ = {};
+    // Count, data and PEC of the longest block read
+    std::array<uint8_t, MaximumBlockSize + 2> rx_ = {};
+    volatile bool busy_ = false;
+    volatile I2C_Error_Type status_ = I2C_Error_Type::OK;
+    Command_Callback callback_;
+    Result_Type result_type_ = Result_Type::NONE;
+    uint8_t *byte_result_ = nullptr;
+    uint16_t *word_result_ = nullptr;
+    std::span<uint8_t> block_result_;
+    size_t *length_result_ = nullptr;
+
+    Alert_Handler alert_handler_;
+    std::array<uint8_t, 2> alert_rx_ = {};
+    volatile bool alert_active_ = false;
+    uint32_t alert_responses_ = 0;
+    volatile uint32_t alerts_ = 0;
+    volatile uint32_t pec_errors_ = 0;
+
+    bool claim();
+    I2C_Error_Type start(uint8_t address, size_t tx_length, size_t rx_length, Result_Type result_type,
+                         Command_Callback callback);
+    void on_complete(I2C_Error_Type status);
+    I2C_Error_Type store_result();
+    void on_alert();
+    void request_alert_response();
+    void on_alert_response(I2C_Error_Type status);
+};
+
+} // namespace i2c
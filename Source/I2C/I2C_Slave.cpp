@@ -0,0 +1,193 @@
+// gd32f30x I2C register map slave in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "I2C_Slave.hpp"
+
+namespace i2c {
+
+constexpr uint32_t ErrorFlags = bit_mask(STAT0_Bits::BERR) | bit_mask(STAT0_Bits::LOSTARB) |
+                                bit_mask(STAT0_Bits::AERR) | bit_mask(STAT0_Bits::OUERR);
+
+I2C_Error_Type Register_Slave::begin(const I2C_Slave_Config& config, std::span<uint8_t> registers,
+                                     std::span<const uint8_t> write_masks, Commit_Callback callback) {
+    if (registers.empty() || (registers.size() > MaximumRegisters) || (write_masks.size() != registers.size())) {
+        return I2C_Error_Type::INVALID_SELECTION;
+    }
+    if (((config.format == Address_Format::FORMAT_7BITS) ? (config.address > 0x7F) : (config.address > AddressMask)) ||
+            (config.address2 > Address2Mask)) {
+        return I2C_Error_Type::INVALID_SELECTION;
+    }
+
+    registers_ = registers;
+    write_masks_ = write_masks;
+    callback_ = callback;
+    pointer_ = 0;
+    last_pointer_ = 0;
+    expect_pointer_ = false;
+    transmitting_ = false;
+    general_call_ = false;
+    dirty_count_ = 0;
+    reads_ = 0;
+    writes_ = 0;
+    rejected_ = 0;
+    bus_errors_ = 0;
+
+    // SADDR0 holds a 7-bit address in bits 7:1
+    const uint32_t own_address = (config.format == Address_Format::FORMAT_7BITS) ?
+                                 (static_cast<uint32_t>(config.address) << 1) : config.address;
+    i2c_.set_enable(false);
+    i2c_.set_address_format(own_address, config.format, Bus_Mode::I2C);
+    i2c_.set_dual_address_enable(config.address2, config.address2 != 0);
+    i2c_.set_general_call_respond(config.general_call);
+    i2c_.set_stretch_low(Stretch_Low::SCLSTRETCH_ENABLE);
+    write_bits(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::DMAON), Clear,
+               static_cast<uint32_t>(CTL1_Bits::EVIE), Set,
+               static_cast<uint32_t>(CTL1_Bits::BUFIE), Set,
+               static_cast<uint32_t>(CTL1_Bits::ERRIE), Set);
+    NVIC_EnableIRQ(I2C_ev_irqNumber[static_cast<int>(i2c_.base_index_)]);
+    NVIC_EnableIRQ(I2C_er_irqNumber[static_cast<int>(i2c_.base_index_)]);
+    i2c_.set_enable(true);
+    // ACKEN only sticks with the peripheral enabled
+    i2c_.set_ack_enable(true);
+
+    return I2C_Error_Type::OK;
+}
+
+void Register_Slave::end() {
+    write_bits(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::EVIE), Clear,
+               static_cast<uint32_t>(CTL1_Bits::BUFIE), Clear,
+               static_cast<uint32_t>(CTL1_Bits::ERRIE), Clear);
+    i2c_.set_ack_enable(false);
+    transmitting_ = false;
+    dirty_count_ = 0;
+}
+
+void Register_Slave::handle_event_interrupt() {
+    const uint32_t stat0 = read_register<uint32_t>(i2c_, I2C_Regs::STAT0);
+
+    if ((stat0 & bit_mask(STAT0_Bits::ADDSEND)) != 0) {
+        // Completes the ADDSEND clear started by the STAT0 read
+        const uint32_t stat1 = read_register<uint32_t>(i2c_, I2C_Regs::STAT1);
+        // A repeated start ends the write before it
+        commit();
+        write_bit(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::BUFIE), Set);
+        general_call_ = (stat1 & bit_mask(STAT1_Bits::RXGC)) != 0;
+        transmitting_ = (stat1 & bit_mask(STAT1_Bits::TR)) != 0;
+        if (transmitting_) {
+            reads_ = reads_ + 1;
+            // SCL is stretched until DATA is filled, do it now rather than on TBE
+            load_next();
+        } else {
+            expect_pointer_ = !general_call_;
+        }
+        return;
+    }
+
+    if ((stat0 & bit_mask(STAT0_Bits::RBNE)) != 0) {
+        receive(static_cast<uint8_t>(read_register<uint32_t>(i2c_, I2C_Regs::DATA)));
+    } else if (transmitting_ && ((stat0 & bit_mask(STAT0_Bits::TBE)) != 0)) {
+        load_next();
+    }
+
+    if ((stat0 & bit_mask(STAT0_Bits::STPDET)) != 0) {
+        // STPDET clears with a CTL0 write after the STAT0 read
+        i2c_.set_ack_enable(true);
+        commit();
+    }
+}
+
+//
+// AERR is how a slave transmitter sees the end of a read: the host NACKs
+// the last byte it wants. If the preloaded byte was never sent, TBE is
+// still clear and the pointer steps back over it.
+//
+void Register_Slave::handle_error_interrupt() {
+    const uint32_t stat0 = read_register<uint32_t>(i2c_, I2C_Regs::STAT0);
+    const uint32_t errors = stat0 & ErrorFlags;
+    if (errors == 0) {
+        return;
+    }
+    // The error flags clear on a zero write, ones leave the other flags alone
+    write_register(i2c_, I2C_Regs::STAT0, ~errors & 0xFFFFU);
+
+    if ((errors & bit_mask(STAT0_Bits::AERR)) != 0) {
+        if (transmitting_ && ((stat0 & bit_mask(STAT0_Bits::TBE)) == 0)) {
+            pointer_ = last_pointer_;
+        }
+        transmitting_ = false;
+        // Nothing more to load, TBE would otherwise keep firing until STOP
+        write_bit(i2c_, I2C_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::BUFIE), Clear);
+    }
+    if ((errors & (bit_mask(STAT0_Bits::BERR) | bit_mask(STAT0_Bits::OUERR))) != 0) {
+        bus_errors_ = bus_errors_ + 1;
+        transmitting_ = false;
+        commit();
+    }
+}
+
+void Register_Slave::receive(uint8_t value) {
+    if (general_call_) {
+        if (general_call_callback_) {
+            general_call_callback_(value);
+        }
+        return;
+    }
+    if (expect_pointer_) {
+        expect_pointer_ = false;
+        pointer_ = value;
+        return;
+    }
+    if (pointer_ >= registers_.size()) {
+        rejected_ = rejected_ + 1;
+        return;
+    }
+
+    // A write that wraps past the end is committed in two parts
+    if ((dirty_count_ != 0) && (pointer_ != (dirty_first_ + dirty_count_))) {
+        commit();
+    }
+    if (dirty_count_ == 0) {
+        dirty_first_ = pointer_;
+    }
+    dirty_count_ = dirty_count_ + 1;
+
+    const uint8_t mask = write_masks_[pointer_];
+    if (mask == 0) {
+        rejected_ = rejected_ + 1;
+    } else {
+        registers_[pointer_] = static_cast<uint8_t>((registers_[pointer_] & ~mask) | (value & mask));
+    }
+    advance();
+}
+
+void Register_Slave::load_next() {
+    last_pointer_ = pointer_;
+    if (pointer_ < registers_.size()) {
+        write_register(i2c_, I2C_Regs::DATA, static_cast<uint32_t>(registers_[pointer_]));
+        advance();
+    } else {
+        write_register(i2c_, I2C_Regs::DATA, static_cast<uint32_t>(FillByte));
+    }
+}
+
+void Register_Slave::advance() {
+    if (pointer_ < registers_.size()) {
+        pointer_ = ((pointer_ + 1U) < registers_.size()) ? static_cast<uint8_t>(pointer_ + 1U) : 0;
+    }
+}
+
+void Register_Slave::commit() {
+    if (dirty_count_ == 0) {
+        return;
+    }
+    const size_t first = dirty_first_;
+    const size_t count = dirty_count_;
+    dirty_count_ = 0;
+    writes_ = writes_ + 1;
+    if (callback_) {
+        callback_(static_cast<uint8_t>(first), registers_.subspan(first, count));
+    }
+}
+
+} // namespace i2c
@@ -0,0 +1,104 @@
+// gd32f30x I2C register map slave in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "I2C.hpp"
+
+namespace i2c {
+
+//
+// Makes the MCU look like a register mapped I2C device. The first byte of a
+// write sets the register pointer, further bytes are stored at the pointer
+// and a read returns bytes from it; both auto-increment and wrap at the end
+// of the map. Everything works directly on the application's buffer: bytes
+// are masked into it as they arrive and the commit callback gets a span of
+// the registers written, at STOP or at a repeated start.
+//
+// Every byte of write_masks holds the bits of its register the host may
+// change, 0 makes the register read-only. A pointer past the map reads as
+// FillByte and drops writes. Both own addresses share the map; general call
+// bytes go to their own callback.
+//
+// Clock stretching stays on, so the host waits for the interrupt rather
+// than reading stale data. The slave transmitter always preloads one byte
+// ahead; when the host ends the read the pointer is moved back over a byte
+// that was loaded but never sent. Multi-byte values the host must read
+// consistently should be updated inside a cortex::Critical_Section.
+//
+// The I2C pins and clock must be configured first. The application forwards
+// I2Cx_EV_IRQHandler and I2Cx_ER_IRQHandler; callbacks run from there.
+//
+class Register_Slave {
+public:
+    using Commit_Callback = std::function<void(uint8_t first_register, std::span<const uint8_t> registers)>;
+    using General_Call_Callback = std::function<void(uint8_t value)>;
+
+    static constexpr size_t MaximumRegisters = 256;
+    static constexpr uint8_t FillByte = 0xFF;
+
+    explicit Register_Slave(I2C& i2c) : i2c_(i2c) {}
+
+    // registers and write_masks must be the same size
+    I2C_Error_Type begin(const I2C_Slave_Config& config, std::span<uint8_t> registers,
+                         std::span<const uint8_t> write_masks, Commit_Callback callback = nullptr);
+    void end();
+
+    void set_general_call_callback(General_Call_Callback callback) {
+        general_call_callback_ = callback;
+    }
+
+    uint8_t get_pointer() const {
+        return pointer_;
+    }
+    uint32_t get_read_count() const {
+        return reads_;
+    }
+    uint32_t get_write_count() const {
+        return writes_;
+    }
+    // Bytes aimed at read-only registers or past the map
+    uint32_t get_rejected_count() const {
+        return rejected_;
+    }
+    uint32_t get_bus_error_count() const {
+        return bus_errors_;
+    }
+
+    // Call from I2Cx_EV_IRQHandler and I2Cx_ER_IRQHandler
+    void handle_event_interrupt();
+    void handle_error_interrupt();
+
+private:
+    I2C& i2c_;
+    std::span<uint8_t> registers_;
+    std::span<const uint8_t> write_masks_;
+    Commit_Callback callback_;
+    General_Call_Callback general_call_callback_;
+
+    uint8_t pointer_ = 0;
+    uint8_t last_pointer_ = 0;
+    bool expect_pointer_ = false;
+    bool transmitting_ = false;
+    bool general_call_ = false;
+    size_t dirty_first_ = 0;
+    size_t dirty_count_ = 0;
+
+    volatile uint32_t reads_ = 0;
+    volatile uint32_t writes_ = 0;
+    volatile uint32_t rejected_ = 0;
+    volatile uint32_t bus_errors_ = 0;
+
+    void receive(uint8_t value);
+    void load_next();
+    void advance();
+    void commit();
+};
+
+} // namespace i2c
@@ -8,6 +8,7 @@
 #include <cstdint>
 
 #include "CONFIG.hpp"
+#include "dma_config.hpp"
 
 namespace i2c {
 
@@ -24,6 +25,16 @@ static constexpr uintptr_t I2C_baseAddress[] = {
     0x40005800, // I2C1
 };
 
+static constexpr IRQn_Type I2C_ev_irqNumber[] = {
+    I2C0_EV_IRQn,
+    I2C1_EV_IRQn,
+};
+
+static constexpr IRQn_Type I2C_er_irqNumber[] = {
+    I2C0_ER_IRQn,
+    I2C1_ER_IRQn,
+};
+
 
 ///////////////////////////// REGISTER OFFSETS /////////////////////////////
 
@@ -301,6 +312,13 @@ enum class I2C_Error_Type {
     INITIALIZATION_FAILED,
     INVALID_SELECTION,
     INVALID_CLOCK_FREQUENCY,
+    NACK,
+    ARBITRATION_LOST,
+    BUS_ERROR,
+    TIMEOUT,
+    DMA_TRANSFER_ERROR,
+    PEC_ERROR,
+    BLOCK_LENGTH_ERROR,
 };
 
 
@@ -316,6 +334,17 @@ static const I2C_Clock_Config I2C_pclk_index[] = {
     {rcu::RCU_PCLK::PCLK_I2C1, rcu::RCU_PCLK_Reset::PCLK_I2C1RST},
 };
 
+struct I2C_DMA_Channels {
+    dma::DMA_Base dma_base;
+    dma::DMA_Channel rx_channel;
+    dma::DMA_Channel tx_channel;
+};
+
+static const I2C_DMA_Channels I2C_dma_index[] = {
+    {dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL6, dma::DMA_Channel::CHANNEL5},
+    {dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL4, dma::DMA_Channel::CHANNEL3},
+};
+
 struct I2C_Pin_Config {
     gpio::GPIO_Base gpio_port;
     gpio::Pin_Number pin;
@@ -328,12 +357,32 @@ struct I2C_Pins {
     I2C_Pin_Config scl_pin;
 };
 
+// Own address as seen on the bus: 7 bits, or 10 bits with FORMAT_10BITS.
+// address2 is a second 7-bit address, 0 leaves dual addressing off.
+struct I2C_Slave_Config {
+    uint16_t address;
+    Address_Format format;
+    uint8_t address2;
+    bool general_call;
+};
+
+// 24Cxx serial EEPROM. Parts up to 16 Kbit take one address byte and carry
+// the upper address bits in the device address; larger parts take two.
+// write_timeout_cycles bounds the ACK polling after each page write.
+struct EEPROM_Config {
+    uint8_t address;
+    uint32_t size;
+    uint16_t page_size;
+    uint8_t address_bytes;
+    uint32_t write_timeout_cycles;
+};
+
 
 ///////////////////////////// CONSTANTS /////////////////////////////
 
 constexpr uint32_t MaximumClockSpeed = 60;
 constexpr uint32_t MinimumClockSpeed = 2;
 constexpr uint32_t AddressMask = 0x000003FF;
-constexpr uint32_t Address2Mask = 0x000000FE;
+constexpr uint32_t Address2Mask = 0x0000007F;
 
 } // namespace i2c
@@ -94,8 +94,11 @@ public:
     // Function to keep compiler happy
     inline void ensure_clock_enabled() const {}
 
+    SPI_Base base_index_;
+
 private:
-    SPI(SPI_Base Base) : SPI_pclk_info_(SPI_pclk_index[static_cast<int>(Base)]),
+    SPI(SPI_Base Base) : base_index_(Base),
+        SPI_pclk_info_(SPI_pclk_index[static_cast<int>(Base)]),
         base_address_(SPI_baseAddress[static_cast<int>(Base)]) {
         if (!is_clock_enabled) {
             RCU_DEVICE.set_pclk_enable(SPI_pclk_info_.clock_reg, true);
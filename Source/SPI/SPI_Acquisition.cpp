@@ -0,0 +1,196 @@
+// gd32f30x SPI timer paced acquisition in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "SPI_Acquisition.hpp"
+
+namespace spi {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+
+// Timers run at twice their APB clock whenever that APB is divided
+static uint32_t timer_clock_frequency(timer::TIMER_Base base) {
+    const bool apb2 = (base == timer::TIMER_Base::TIMER0_BASE) || (base == timer::TIMER_Base::TIMER7_BASE);
+    const uint32_t ahb = RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_AHB);
+    const uint32_t apb = RCU_DEVICE.get_clock_frequency(apb2 ? rcu::Clock_Frequency::CK_APB2 : rcu::Clock_Frequency::CK_APB1);
+    return (apb == ahb) ? apb : (apb * 2);
+}
+
+SPI_Error_Type Timed_Acquisition::begin(const Config& config) {
+    if (running_) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    const uint32_t ctl0 = read_register<uint32_t>(spi_, SPI_Regs::CTL0);
+    if (((ctl0 & bit_mask(CTL0_Bits::MSTMOD)) == 0) ||
+            ((ctl0 & (bit_mask(CTL0_Bits::CKPH) | bit_mask(CTL0_Bits::RO) | bit_mask(CTL0_Bits::BDEN))) != 0)) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+
+    // Prescaler and reload closest to the requested period
+    const uint32_t clock = timer_clock_frequency(config.timer);
+    const uint32_t ticks = (config.sample_rate == 0) ? 0 : ((clock + (config.sample_rate / 2)) / config.sample_rate);
+    if (ticks < 2) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    const uint32_t prescaler = (ticks - 1) / 0x10000;
+    const uint32_t reload = (ticks / (prescaler + 1)) - 1;
+
+    const SPI_DMA_Channels& spi_channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    const timer::TIMER_DMA_Channel& trigger = timer::TIMER_update_dma_index[static_cast<int>(config.timer)];
+    if ((trigger.dma_base == spi_channels.dma_base) && (trigger.channel == spi_channels.rx_channel)) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+
+    auto timer_result = timer::TIMER::get_instance(config.timer);
+    auto rx_dma_result = dma::DMA::get_instance(spi_channels.dma_base);
+    auto trigger_dma_result = dma::DMA::get_instance(trigger.dma_base);
+    if ((timer_result.error() != timer::TIMER_Error_Type::OK) || (rx_dma_result.error() != dma::DMA_Error_Type::OK) ||
+            (trigger_dma_result.error() != dma::DMA_Error_Type::OK)) {
+        return SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    timer_ = &timer_result.value();
+    rx_dma_ = &rx_dma_result.value();
+    trigger_dma_ = &trigger_dma_result.value();
+    rx_channel_ = spi_channels.rx_channel;
+    trigger_channel_ = trigger.channel;
+    command_ = config.command;
+    achieved_rate_ = clock / ((prescaler + 1) * (reload + 1));
+
+    const dma::Bit_Width frame_width = ((ctl0 & bit_mask(CTL0_Bits::FF16)) != 0) ? dma::Bit_Width::WIDTH_16BIT :
+                                       dma::Bit_Width::WIDTH_8BIT;
+    dma::DMA_Config rx_config = {
+        .peripheral_address = reinterpret_cast<uint32_t>(spi_.reg_address(SPI_Regs::DATA)),
+        .peripheral_bit_width = frame_width,
+        .memory_address = 0,
+        .memory_bit_width = dma::Bit_Width::WIDTH_16BIT,
+        .count = 0,
+        .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+        .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+        .channel_priority = dma::Channel_Priority::ULTRA_HIGH_PRIORITY,
+        .direction = dma::Transfer_Direction::P2M,
+    };
+    dma::DMA_Config trigger_config = rx_config;
+    trigger_config.memory_address = reinterpret_cast<uint32_t>(&command_);
+    trigger_config.count = 1;
+    trigger_config.memory_increase = dma::Increase_Mode::INCREASE_DISABLE;
+    trigger_config.channel_priority = dma::Channel_Priority::HIGH_PRIORITY;
+    trigger_config.direction = dma::Transfer_Direction::M2P;
+
+    rx_dma_->reset(rx_channel_);
+    rx_dma_->configure(rx_channel_, rx_config);
+    rx_dma_->set_circulation_mode_enable(rx_channel_, true);
+    rx_dma_->set_interrupt_enable(rx_channel_, dma::Interrupt_Type::INTR_HTFIE, true);
+    rx_dma_->set_interrupt_enable(rx_channel_, dma::Interrupt_Type::INTR_FTFIE, true);
+    rx_dma_->set_interrupt_enable(rx_channel_, dma::Interrupt_Type::INTR_ERRIE, true);
+    NVIC_EnableIRQ(dma::get_irq_number(spi_channels.dma_base, rx_channel_));
+    trigger_dma_->reset(trigger_channel_);
+    trigger_dma_->configure(trigger_channel_, trigger_config);
+    trigger_dma_->set_circulation_mode_enable(trigger_channel_, true);
+
+    // NSS driven by hardware and pulsed between frames, set while disabled
+    spi_.disable();
+    write_bit(spi_, SPI_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::SWNSSEN), Clear);
+    write_bits(spi_, SPI_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::NSSDRV), Set,
+               static_cast<uint32_t>(CTL1_Bits::NSSP), Set);
+    spi_.enable();
+
+    timer_->disable();
+    timer_->set_auto_reload_value(static_cast<uint16_t>(reload));
+    timer_->set_prescaler_reload(static_cast<uint16_t>(prescaler), timer::PSC_Reload::RELOAD_NOW);
+
+    return SPI_Error_Type::OK;
+}
+
+void Timed_Acquisition::end() {
+    stop();
+    if (timer_ == nullptr) {
+        return;
+    }
+    spi_.set_nssp_mode_enable(false);
+    timer_ = nullptr;
+    rx_dma_ = nullptr;
+    trigger_dma_ = nullptr;
+}
+
+SPI_Error_Type Timed_Acquisition::start(std::span<uint16_t> buffer, Half_Callback callback) {
+    if ((timer_ == nullptr) || running_) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    if ((buffer.size() < 4) || ((buffer.size() & 1U) != 0) || (buffer.size() > MaximumTransferCount)) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    buffer_ = buffer;
+    callback_ = callback;
+    missed_halves_ = 0;
+    overruns_ = 0;
+    dma_errors_ = 0;
+
+    rx_dma_->set_channel_enable(rx_channel_, false);
+    rx_dma_->clear_flags(dma::channel_all_flags_mask(rx_channel_));
+    rx_dma_->set_data_address(rx_channel_, dma::Data_Type::MEMORY_ADDRESS, reinterpret_cast<uint32_t>(buffer.data()));
+    rx_dma_->set_transfer_count(rx_channel_, static_cast<uint32_t>(buffer.size()));
+    rx_dma_->set_channel_enable(rx_channel_, true);
+
+    // Stale data would shift every sample by one slot
+    read_register<uint32_t>(spi_, SPI_Regs::DATA);
+    read_register<uint32_t>(spi_, SPI_Regs::STAT);
+    spi_.set_dma_enable(DMA_Direction::DMA_RX, true);
+
+    trigger_dma_->clear_flags(dma::channel_all_flags_mask(trigger_channel_));
+    trigger_dma_->set_channel_enable(trigger_channel_, true);
+
+    running_ = true;
+    timer_->set_counter_value(0);
+    timer_->dma_enable(timer::DMAINTEN_Bits::UPDEN);
+    timer_->enable();
+
+    return SPI_Error_Type::OK;
+}
+
+void Timed_Acquisition::stop() {
+    if ((timer_ == nullptr) || !running_) {
+        return;
+    }
+    running_ = false;
+    timer_->disable();
+    timer_->dma_disable(timer::DMAINTEN_Bits::UPDEN);
+    trigger_dma_->set_channel_enable(trigger_channel_, false);
+    spi_.set_dma_enable(DMA_Direction::DMA_RX, false);
+    rx_dma_->set_channel_enable(rx_channel_, false);
+    rx_dma_->clear_flags(dma::channel_all_flags_mask(rx_channel_));
+}
+
+void Timed_Acquisition::handle_dma_interrupt() {
+    if ((rx_dma_ == nullptr) || !running_) {
+        return;
+    }
+    const dma::DMA_Status_Snapshot status = rx_dma_->get_interrupt_snapshot(1U << static_cast<uint32_t>(rx_channel_));
+    rx_dma_->clear_flags(status.flags);
+
+    if (status.test(rx_channel_, dma::Status_Flags::FLAG_ERRIF)) {
+        dma_errors_ = dma_errors_ + 1;
+        stop();
+        return;
+    }
+    // RXORERR clears on a DATA read followed by a STAT read. The DMA has read
+    // DATA since the overrun, so this STAT read finishes the sequence; a CPU
+    // read of DATA would take the next sample away from the ring.
+    if ((read_register<uint32_t>(spi_, SPI_Regs::STAT) & bit_mask(STAT_Bits::RXORERR)) != 0) {
+        overruns_ = overruns_ + 1;
+    }
+
+    const bool half = status.test(rx_channel_, dma::Status_Flags::FLAG_HTFIF);
+    const bool full = status.test(rx_channel_, dma::Status_Flags::FLAG_FTFIF);
+    if (!half && !full) {
+        return;
+    }
+    if (half && full) {
+        missed_halves_ = missed_halves_ + 1;
+    }
+    const size_t half_size = buffer_.size() / 2;
+    if (callback_) {
+        callback_(full ? std::span<const uint16_t>(buffer_).subspan(half_size) : std::span<const uint16_t>(buffer_).first(half_size));
+    }
+}
+
+} // namespace spi
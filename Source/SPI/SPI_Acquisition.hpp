@@ -0,0 +1,93 @@
+// gd32f30x SPI timer paced acquisition in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "DMA.hpp"
+#include "SPI.hpp"
+#include "TIMER.hpp"
+
+namespace spi {
+
+//
+// Continuous sampling of an external SPI ADC without CPU work per sample.
+// Each update event of a timer makes its DMA channel write the command
+// word into DATA, which clocks one frame; NSS pulse mode (NSSP) raises NSS
+// between frames to start the next conversion. The SPI RX DMA channel
+// stores the results in circular mode over a caller buffer, and the
+// callback gets each half once it is complete.
+//
+// The SPI is configured by the caller as a full-duplex master with
+// hardware NSS and clock phase on the first edge (NSSP requirement), and
+// must clock a frame well within one sample period. The timer is owned by
+// the acquisition: only its prescaler, reload and UPDEN are set. Its update
+// DMA channel must not be the SPI RX channel.
+//
+// Samples are always stored as half-words, 8-bit frames are zero extended
+// by DMA. The application forwards the SPI RX DMA channel interrupt to
+// handle_dma_interrupt().
+//
+class Timed_Acquisition {
+public:
+    using Half_Callback = std::function<void(std::span<const uint16_t> half)>;
+
+    struct Config {
+        timer::TIMER_Base timer;
+        uint32_t sample_rate;
+        uint16_t command;       // Clocked out with every conversion
+    };
+
+    explicit Timed_Acquisition(SPI& spi) : spi_(spi) {}
+
+    SPI_Error_Type begin(const Config& config);
+    void end();
+
+    // buffer must hold an even number of samples, at least four
+    SPI_Error_Type start(std::span<uint16_t> buffer, Half_Callback callback);
+    void stop();
+
+    bool is_running() const {
+        return running_;
+    }
+    // Rate the timer actually runs at
+    uint32_t get_sample_rate() const {
+        return achieved_rate_;
+    }
+    uint32_t get_missed_half_count() const {
+        return missed_halves_;
+    }
+    // Half buffers during which RXORERR was raised, RX DMA was late at least
+    // once there. Not a count of lost frames, the flag is only sampled here.
+    uint32_t get_overrun_count() const {
+        return overruns_;
+    }
+    uint32_t get_dma_error_count() const {
+        return dma_errors_;
+    }
+
+    // Call from the IRQ handler of the SPI RX DMA channel
+    void handle_dma_interrupt();
+
+private:
+    SPI& spi_;
+    timer::TIMER* timer_ = nullptr;
+    dma::DMA* rx_dma_ = nullptr;
+    dma::DMA* trigger_dma_ = nullptr;
+    dma::DMA_Channel rx_channel_ = dma::DMA_Channel::CHANNEL0;
+    dma::DMA_Channel trigger_channel_ = dma::DMA_Channel::CHANNEL0;
+    uint16_t command_ = 0;
+    uint32_t achieved_rate_ = 0;
+    std::span<uint16_t> buffer_;
+    Half_Callback callback_;
+    volatile bool running_ = false;
+    volatile uint32_t missed_halves_ = 0;
+    volatile uint32_t overruns_ = 0;
+    volatile uint32_t dma_errors_ = 0;
+};
+
+} // namespace spi
@@ -0,0 +1,234 @@
+// gd32f30x SPI shared bus manager in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "SPI_Bus.hpp"
+
+namespace spi {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+
+SPI_Error_Type SPI_Bus::begin(std::span<Transaction> queue_storage) {
+    if (!queue_.attach(queue_storage)) {
+        return SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    SPI_Error_Type result = dma_.begin();
+    if (result != SPI_Error_Type::OK) {
+        return result;
+    }
+    busy_ = false;
+    // Forces a CTL0 write for the first transaction
+    current_ctl0_ = 0;
+    switches_ = 0;
+    running_ = true;
+    return SPI_Error_Type::OK;
+}
+
+void SPI_Bus::end() {
+    running_ = false;
+    dma_.end();
+    for (size_t i = 0; i < device_count_; ++i) {
+        *devices_[i].cs_release_reg = devices_[i].cs_mask;
+    }
+    queue_.clear();
+    busy_ = false;
+}
+
+SPI_Error_Type SPI_Bus::add_device(const SPI_Device_Config& config, Device_Handle& handle) {
+    if (device_count_ >= MaximumDevices) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    auto gpio_result = gpio::GPIO::get_instance(config.cs_port);
+    if (gpio_result.error() != gpio::GPIO_Error_Type::OK) {
+        return SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    gpio::GPIO& cs_port = gpio_result.value();
+
+    Device& device = devices_[device_count_];
+    device.ctl0 = device_ctl0_image(config);
+    device.cs_mask = 1U << static_cast<uint32_t>(config.cs_pin);
+    device.cs_assert_reg = cs_port.reg_address(config.cs_active_high ? gpio::GPIO_Regs::BOP : gpio::GPIO_Regs::BC);
+    device.cs_release_reg = cs_port.reg_address(config.cs_active_high ? gpio::GPIO_Regs::BC : gpio::GPIO_Regs::BOP);
+    device.wide = (config.frame_format == Frame_Format::FF_16BIT);
+
+    // Deselected before the pin becomes an output
+    *device.cs_release_reg = device.cs_mask;
+    cs_port.init_pin(config.cs_pin, gpio::Pin_Mode::OUTPUT_PUSHPULL, gpio::Output_Speed::SPEED_50MHZ);
+
+    handle = static_cast<Device_Handle>(device_count_);
+    device_count_ = device_count_ + 1;
+    return SPI_Error_Type::OK;
+}
+
+SPI_Error_Type SPI_Bus::submit(Device_Handle device, std::span<const uint8_t> header, std::span<const uint8_t> tx,
+                               std::span<uint8_t> rx, Transaction_Callback callback) {
+    return enqueue(Transaction{device, header, tx, rx, callback, nullptr});
+}
+
+SPI_Error_Type SPI_Bus::transfer_blocking(Device_Handle device, std::span<const uint8_t> header, std::span<const uint8_t> tx,
+                                          std::span<uint8_t> rx, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    Completion completion;
+    SPI_Error_Type result = enqueue(Transaction{device, header, tx, rx, nullptr, &completion});
+    if (result != SPI_Error_Type::OK) {
+        return result;
+    }
+
+    while (!completion.done) {
+        if (deadline.expired()) {
+            cancel(completion);
+        }
+    }
+    return completion.status;
+}
+
+SPI_Error_Type SPI_Bus::validate(const Transaction& transaction) const {
+    if (!running_) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    if (transaction.device >= device_count_) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    if ((transaction.header.empty() && transaction.tx.empty() && transaction.rx.empty()) ||
+            (!transaction.tx.empty() && !transaction.rx.empty() && (transaction.tx.size() != transaction.rx.size()))) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+
+    const bool wide = devices_[transaction.device].wide;
+    const size_t frame_size = wide ? 2 : 1;
+    for (const std::span<const uint8_t> data : {transaction.header, transaction.tx, std::span<const uint8_t>(transaction.rx)}) {
+        if ((data.size() / frame_size) > MaximumTransferCount) {
+            return SPI_Error_Type::INVALID_SELECTION;
+        }
+        if (wide && (((data.size() | reinterpret_cast<uintptr_t>(data.data())) & 1U) != 0)) {
+            return SPI_Error_Type::INVALID_SELECTION;
+        }
+    }
+    return SPI_Error_Type::OK;
+}
+
+//
+// Producers may be tasks and interrupts of any priority, the push and the
+// idle check are done with interrupts off. Only an idle bus is kicked from
+// here, otherwise the completion of the running transaction starts the next.
+//
+SPI_Error_Type SPI_Bus::enqueue(const Transaction& transaction) {
+    SPI_Error_Type result = validate(transaction);
+    if (result != SPI_Error_Type::OK) {
+        return result;
+    }
+
+    bool kick = false;
+    {
+        cortex::Critical_Section section;
+        if (!queue_.push(transaction)) {
+            return SPI_Error_Type::INVALID_OPERATION;
+        }
+        if (!busy_) {
+            busy_ = true;
+            kick = true;
+        }
+    }
+    if (kick) {
+        start_next();
+    }
+    return SPI_Error_Type::OK;
+}
+
+//
+// A blocking transfer ran out of time. If its transaction is on the wire the
+// DMA is stopped, the chip select released and the next one started; a
+// transaction still queued is discarded.
+//
+void SPI_Bus::cancel(Completion& completion) {
+    {
+        cortex::Critical_Section section;
+        if (completion.done) {
+            return;
+        }
+        if (!queue_.is_front(completion) || !dma_.cancel()) {
+            queue_.discard(completion, SPI_Error_Type::TIMEOUT);
+            return;
+        }
+    }
+    // The DMA is stopped and its callback dropped, the rest runs with interrupts enabled
+    complete(SPI_Error_Type::TIMEOUT);
+}
+
+//
+// Runs in whichever context owns busy_. The skip, the hand-off of busy_ and
+// the start itself are done with interrupts off, so a cancel sees either a
+// running transfer or a queued one. A transaction that cannot start is
+// completed here and the loop moves on.
+//
+void SPI_Bus::start_next() {
+    for (;;) {
+        SPI_Error_Type result;
+        {
+            cortex::Critical_Section section;
+            if (!queue_.skip_discarded()) {
+                busy_ = false;
+                return;
+            }
+            const Transaction& transaction = queue_.front();
+
+            const Device& device = devices_[transaction.device];
+            if (device.ctl0 != current_ctl0_) {
+                // Clock and frame settings only change with SPIEN cleared
+                write_register(spi_, SPI_Regs::CTL0, device.ctl0 & ~bit_mask(CTL0_Bits::SPIEN));
+                write_register(spi_, SPI_Regs::CTL0, device.ctl0);
+                current_ctl0_ = device.ctl0;
+                switches_ = switches_ + 1;
+            }
+            *device.cs_assert_reg = device.cs_mask;
+
+            if (!transaction.header.empty()) {
+                phase_ = Phase::HEADER;
+                result = start_phase(device, transaction.header, std::span<uint8_t>());
+            } else {
+                phase_ = Phase::DATA;
+                result = start_phase(device, transaction.tx, transaction.rx);
+            }
+            if (result == SPI_Error_Type::OK) {
+                return;
+            }
+            *device.cs_release_reg = device.cs_mask;
+        }
+        queue_.finish(result);
+    }
+}
+
+SPI_Error_Type SPI_Bus::start_phase(const Device& device, std::span<const uint8_t> tx, std::span<uint8_t> rx) {
+    auto callback = [this](SPI_Error_Type status) {
+        on_phase_complete(status);
+    };
+    if (!device.wide) {
+        return dma_.transfer(tx, rx, callback);
+    }
+    return dma_.transfer(std::span<const uint16_t>(reinterpret_cast<const uint16_t*>(tx.data()), tx.size() / 2),
+                         std::span<uint16_t>(reinterpret_cast<uint16_t*>(rx.data()), rx.size() / 2), callback);
+}
+
+void SPI_Bus::on_phase_complete(SPI_Error_Type status) {
+    const Transaction& transaction = queue_.front();
+    if ((status == SPI_Error_Type::OK) && (phase_ == Phase::HEADER) &&
+            (!transaction.tx.empty() || !transaction.rx.empty())) {
+        phase_ = Phase::DATA;
+        status = start_phase(devices_[transaction.device], transaction.tx, transaction.rx);
+        if (status == SPI_Error_Type::OK) {
+            return;
+        }
+    }
+    complete(status);
+}
+
+// busy_ stays set, so transactions submitted from the callback are only queued
+void SPI_Bus::complete(SPI_Error_Type status) {
+    const Device& device = devices_[queue_.front().device];
+    *device.cs_release_reg = device.cs_mask;
+    queue_.finish(status);
+    start_next();
+}
+
+} // namespace spi
@@ -0,0 +1,120 @@
+// gd32f30x SPI shared bus manager in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "TransactionQueue.hpp"
+#include "SPI_DMA.hpp"
+
+namespace spi {
+
+//
+// Several devices with different modes on one SPI master. Each device keeps
+// a precomputed CTL0 image (mode, prescaler, frame format, bit order), so
+// moving to another device is a CTL0 store with SPIEN dropped and one with
+// the new image, plus a BOP/BC store for its chip select. Consecutive
+// transactions on the same device skip CTL0 entirely.
+//
+// Transactions are queued from tasks or interrupts and run back to back by
+// DMA: an optional write-only header (command, register, address) and a
+// data phase, both under one chip select. With 16-bit frames the data
+// buffers hold whole half-words and must be 2-byte aligned.
+//
+// The bus owns CTL0 while it is running; SPI::configure() must not be used
+// until end(). The application forwards both DMA channel interrupts to
+// handle_dma_interrupt(), callbacks run from there.
+//
+class SPI_Bus {
+public:
+    using Device_Handle = uint8_t;
+    using Transaction_Callback = std::function<void(SPI_Error_Type status)>;
+
+    static constexpr size_t MaximumDevices = 8;
+
+    using Completion = ::Completion<SPI_Error_Type>;
+
+    struct Transaction {
+        Device_Handle device;
+        std::span<const uint8_t> header;
+        // tx and rx must have the same size unless one of them is empty
+        std::span<const uint8_t> tx;
+        std::span<uint8_t> rx;
+        Transaction_Callback callback;
+        Completion* completion;
+    };
+
+    explicit SPI_Bus(SPI& spi) : spi_(spi), dma_(spi) {}
+
+    // Queue storage size must be a power of two. The SPI pins must already
+    // be configured with SPI::pins_configure().
+    SPI_Error_Type begin(std::span<Transaction> queue_storage);
+    void end();
+
+    SPI_Error_Type add_device(const SPI_Device_Config& config, Device_Handle& handle);
+
+    // Buffers must stay valid until the callback runs
+    SPI_Error_Type submit(Device_Handle device, std::span<const uint8_t> header, std::span<const uint8_t> tx,
+                          std::span<uint8_t> rx, Transaction_Callback callback = nullptr);
+    // Task context only, queued behind whatever is pending. Any number of
+    // tasks may block at once, each waits for its own transaction.
+    SPI_Error_Type transfer_blocking(Device_Handle device, std::span<const uint8_t> header, std::span<const uint8_t> tx,
+                                     std::span<uint8_t> rx, uint32_t timeout_cycles = cortex::Deadline::Infinite);
+
+    bool is_idle() const {
+        return !busy_;
+    }
+    size_t queued() const {
+        return queue_.size();
+    }
+    // CTL0 rewrites, a measure of how often the bus changes mode
+    uint32_t get_switch_count() const {
+        return switches_;
+    }
+
+    // Call from the IRQ handlers of both the RX and TX DMA channels
+    void handle_dma_interrupt() {
+        dma_.handle_dma_interrupt();
+    }
+
+private:
+    struct Device {
+        uint32_t ctl0;
+        volatile uint32_t *cs_assert_reg;
+        volatile uint32_t *cs_release_reg;
+        uint32_t cs_mask;
+        bool wide;
+    };
+
+    enum class Phase {
+        HEADER,
+        DATA,
+    };
+
+    SPI& spi_;
+    DMA_Transfer dma_;
+    std::array<Device, MaximumDevices> devices_ = {};
+    size_t device_count_ = 0;
+    Transaction_Queue<Transaction, SPI_Error_Type> queue_;
+    volatile bool busy_ = false;
+    bool running_ = false;
+    Phase phase_ = Phase::HEADER;
+    uint32_t current_ctl0_ = 0;
+    volatile uint32_t switches_ = 0;
+
+    SPI_Error_Type validate(const Transaction& transaction) const;
+    SPI_Error_Type enqueue(const Transaction& transaction);
+    void cancel(Completion& completion);
+    void start_next();
+    SPI_Error_Type start_phase(const Device& device, std::span<const uint8_t> tx, std::span<uint8_t> rx);
+    void on_phase_complete(SPI_Error_Type status);
+    void complete(SPI_Error_Type status);
+};
+
+} // namespace spi
@@ -0,0 +1,288 @@
+// gd32f30x SPI DMA transfers in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "SPI_DMA.hpp"
+
+namespace spi {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+
+SPI_Error_Type DMA_Transfer::begin() {
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+
+    auto dma_result = dma::DMA::get_instance(channels.dma_base);
+    if (dma_result.error() != dma::DMA_Error_Type::OK) {
+        return SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    dma_ = &dma_result.value();
+
+    dma::DMA_Config rx_config = {
+        .peripheral_address = reinterpret_cast<uint32_t>(spi_.reg_address(SPI_Regs::DATA)),
+        .peripheral_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .memory_address = 0,
+        .memory_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .count = 0,
+        .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+        .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+        .channel_priority = dma::Channel_Priority::HIGH_PRIORITY,
+        .direction = dma::Transfer_Direction::P2M,
+    };
+    dma::DMA_Config tx_config = rx_config;
+    tx_config.channel_priority = dma::Channel_Priority::MEDIUM_PRIORITY;
+    tx_config.direction = dma::Transfer_Direction::M2P;
+
+    dma_->reset(channels.rx_channel);
+    dma_->configure(channels.rx_channel, rx_config);
+    dma_->set_interrupt_enable(channels.rx_channel, dma::Interrupt_Type::INTR_FTFIE, true);
+    dma_->set_interrupt_enable(channels.rx_channel, dma::Interrupt_Type::INTR_ERRIE, true);
+    dma_->reset(channels.tx_channel);
+    dma_->configure(channels.tx_channel, tx_config);
+    dma_->set_interrupt_enable(channels.tx_channel, dma::Interrupt_Type::INTR_ERRIE, true);
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channels.rx_channel));
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channels.tx_channel));
+
+    busy_ = false;
+    return SPI_Error_Type::OK;
+}
+
+void DMA_Transfer::end() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    spi_.set_dma_enable(DMA_Direction::DMA_TX, false);
+    spi_.set_dma_enable(DMA_Direction::DMA_RX, false);
+    dma_->set_channel_enable(channels.rx_channel, false);
+    dma_->set_channel_enable(channels.tx_channel, false);
+    busy_ = false;
+    dma_ = nullptr;
+}
+
+//
+// CRCPOLY and CRCEN only change with SPIEN cleared, and clearing CRCEN also
+// resets both CRC registers.
+//
+SPI_Error_Type DMA_Transfer::set_crc_framing(bool enable, uint16_t polynomial) {
+    if (busy_) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    if (enable && ((polynomial & 1U) == 0)) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    const uint32_t ctl0 = read_register<uint32_t>(spi_, SPI_Regs::CTL0) & ~bit_mask(CTL0_Bits::CRCEN);
+    const uint32_t disabled = ctl0 & ~bit_mask(CTL0_Bits::SPIEN);
+    write_register(spi_, SPI_Regs::CTL0, disabled);
+    if (enable) {
+        spi_.set_crc_polynomial(polynomial);
+        write_register(spi_, SPI_Regs::CTL0, disabled | bit_mask(CTL0_Bits::CRCEN));
+        write_register(spi_, SPI_Regs::CTL0, ctl0 | bit_mask(CTL0_Bits::CRCEN));
+    } else {
+        write_register(spi_, SPI_Regs::CTL0, ctl0);
+    }
+    spi_.clear_crc_error();
+    crc_enabled_ = enable;
+    crc_errors_ = 0;
+    return SPI_Error_Type::OK;
+}
+
+SPI_Error_Type DMA_Transfer::transfer_blocking(std::span<const uint8_t> tx, std::span<uint8_t> rx, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    SPI_Error_Type result = transfer(tx, rx);
+    return (result != SPI_Error_Type::OK) ? result : wait(deadline);
+}
+
+SPI_Error_Type DMA_Transfer::transfer_blocking(std::span<const uint16_t> tx, std::span<uint16_t> rx, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    SPI_Error_Type result = transfer(tx, rx);
+    return (result != SPI_Error_Type::OK) ? result : wait(deadline);
+}
+
+//
+// RX is armed before TX: with DMATEN set the first frame is written to
+// DATA at once and its clocks start, the RX channel must already be waiting.
+//
+SPI_Error_Type DMA_Transfer::start(const void* tx, void* rx, size_t tx_count, size_t rx_count, bool wide,
+                                   uint16_t fill, Transfer_Callback callback) {
+    if (dma_ == nullptr) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    const size_t length = (tx_count == 0) ? rx_count : tx_count;
+    if ((length == 0) || (length > MaximumTransferCount) || ((tx_count != 0) && (rx_count != 0) && (tx_count != rx_count))) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    const bool ff16 = (read_register<uint32_t>(spi_, SPI_Regs::CTL0) & bit_mask(CTL0_Bits::FF16)) != 0;
+    if (ff16 != wide) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    if (busy_) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    busy_ = true;
+    status_ = SPI_Error_Type::OK;
+    callback_ = callback;
+    // The TX channel reads the fill for the whole transfer, fill_ may change meanwhile
+    transfer_fill_ = fill;
+
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    const dma::DMA_Channel rx_channel = channels.rx_channel;
+    const dma::DMA_Channel tx_channel = channels.tx_channel;
+    const dma::Bit_Width width = wide ? dma::Bit_Width::WIDTH_16BIT : dma::Bit_Width::WIDTH_8BIT;
+
+    // Drop a frame left over from polled use, this also clears RXORERR
+    read_register<uint32_t>(spi_, SPI_Regs::DATA);
+    read_register<uint32_t>(spi_, SPI_Regs::STAT);
+    // Each transfer is one CRC block. A write-only transfer still sends the
+    // CRC, but what comes back is not checked.
+    crc_check_ = crc_enabled_ && (rx_count != 0);
+    crc_phase_ = false;
+    if (crc_enabled_) {
+        restart_crc();
+    }
+    dma_->clear_flags(dma::channel_all_flags_mask(rx_channel) | dma::channel_all_flags_mask(tx_channel));
+
+    dma_->set_channel_enable(rx_channel, false);
+    dma_->set_bit_width(rx_channel, dma::Data_Type::PERIPHERAL_ADDRESS, width);
+    dma_->set_bit_width(rx_channel, dma::Data_Type::MEMORY_ADDRESS, width);
+    dma_->set_data_address(rx_channel, dma::Data_Type::MEMORY_ADDRESS,
+                           reinterpret_cast<uint32_t>((rx_count == 0) ? &dummy_rx_ : rx));
+    dma_->set_increase_mode_enable(rx_channel, dma::Data_Type::MEMORY_ADDRESS, rx_count != 0);
+    dma_->set_transfer_count(rx_channel, static_cast<uint32_t>(length));
+
+    dma_->set_channel_enable(tx_channel, false);
+    dma_->set_bit_width(tx_channel, dma::Data_Type::PERIPHERAL_ADDRESS, width);
+    dma_->set_bit_width(tx_channel, dma::Data_Type::MEMORY_ADDRESS, width);
+    dma_->set_data_address(tx_channel, dma::Data_Type::MEMORY_ADDRESS,
+                           reinterpret_cast<uint32_t>((tx_count == 0) ? &transfer_fill_ : tx));
+    dma_->set_increase_mode_enable(tx_channel, dma::Data_Type::MEMORY_ADDRESS, tx_count != 0);
+    dma_->set_transfer_count(tx_channel, static_cast<uint32_t>(length));
+
+    dma_->set_channel_enable(rx_channel, true);
+    spi_.set_dma_enable(DMA_Direction::DMA_RX, true);
+    dma_->set_channel_enable(tx_channel, true);
+    spi_.set_dma_enable(DMA_Direction::DMA_TX, true);
+
+    return SPI_Error_Type::OK;
+}
+
+void DMA_Transfer::abort() {
+    finish(SPI_Error_Type::TIMEOUT);
+}
+
+bool DMA_Transfer::cancel() {
+    cortex::Critical_Section section;
+    Transfer_Callback callback;
+    return take(SPI_Error_Type::TIMEOUT, callback);
+}
+
+SPI_Error_Type DMA_Transfer::wait(const cortex::Deadline& deadline) {
+    while (busy_) {
+        if (deadline.expired()) {
+            // Reports the real status if the interrupt got there first
+            finish(SPI_Error_Type::TIMEOUT);
+            break;
+        }
+    }
+    return status_;
+}
+
+void DMA_Transfer::handle_dma_interrupt() {
+    if ((dma_ == nullptr) || !busy_) {
+        return;
+    }
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    const uint32_t channel_mask = (1U << static_cast<uint32_t>(channels.rx_channel)) |
+                                  (1U << static_cast<uint32_t>(channels.tx_channel));
+    const dma::DMA_Status_Snapshot status = dma_->get_interrupt_snapshot(channel_mask);
+    dma_->clear_flags(status.flags);
+
+    if (status.test(channels.rx_channel, dma::Status_Flags::FLAG_ERRIF) ||
+            status.test(channels.tx_channel, dma::Status_Flags::FLAG_ERRIF)) {
+        finish(SPI_Error_Type::DMA_TRANSFER_ERROR);
+    } else if (status.test(channels.rx_channel, dma::Status_Flags::FLAG_FTFIF)) {
+        if (crc_enabled_ && !crc_phase_) {
+            receive_crc();
+            return;
+        }
+        finish(crc_enabled_ ? check_crc() : SPI_Error_Type::OK);
+    }
+}
+
+void DMA_Transfer::restart_crc() {
+    const uint32_t ctl0 = read_register<uint32_t>(spi_, SPI_Regs::CTL0);
+    const uint32_t disabled = ctl0 & ~bit_mask(CTL0_Bits::SPIEN);
+    write_register(spi_, SPI_Regs::CTL0, disabled & ~bit_mask(CTL0_Bits::CRCEN));
+    write_register(spi_, SPI_Regs::CTL0, disabled | bit_mask(CTL0_Bits::CRCEN));
+    write_register(spi_, SPI_Regs::CTL0, ctl0 | bit_mask(CTL0_Bits::CRCEN));
+    spi_.clear_crc_error();
+}
+
+//
+// RX DMA is done with the data and the CRC frame follows it into DATA. The
+// RX channel is re-armed for that one frame; RBNE holds the request, so a
+// frame that is already there is taken as soon as the channel is enabled.
+//
+void DMA_Transfer::receive_crc() {
+    const dma::DMA_Channel rx_channel = SPI_dma_index[static_cast<int>(spi_.base_index_)].rx_channel;
+    crc_phase_ = true;
+    received_crc_ = 0;
+    dma_->set_channel_enable(rx_channel, false);
+    dma_->set_data_address(rx_channel, dma::Data_Type::MEMORY_ADDRESS,
+                           reinterpret_cast<uint32_t>(&received_crc_));
+    dma_->set_increase_mode_enable(rx_channel, dma::Data_Type::MEMORY_ADDRESS, false);
+    dma_->set_transfer_count(rx_channel, 1);
+    dma_->set_channel_enable(rx_channel, true);
+}
+
+// CRCERR is valid once the CRC frame has been received
+SPI_Error_Type DMA_Transfer::check_crc() {
+    if (!crc_check_) {
+        return SPI_Error_Type::OK;
+    }
+    if ((read_register<uint32_t>(spi_, SPI_Regs::STAT) & bit_mask(STAT_Bits::CRCERR)) != 0) {
+        spi_.clear_crc_error();
+        crc_errors_ = crc_errors_ + 1;
+        return SPI_Error_Type::CRC_ERROR;
+    }
+    return SPI_Error_Type::OK;
+}
+
+//
+// Called with interrupts off. Exactly one of the interrupt handler, abort()
+// and cancel() gets the running transfer; the winner stops the channels and
+// takes the callback.
+//
+bool DMA_Transfer::take(SPI_Error_Type status, Transfer_Callback& callback) {
+    if (!busy_) {
+        return false;
+    }
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    spi_.set_dma_enable(DMA_Direction::DMA_TX, false);
+    spi_.set_dma_enable(DMA_Direction::DMA_RX, false);
+    dma_->set_channel_enable(channels.tx_channel, false);
+    dma_->set_channel_enable(channels.rx_channel, false);
+
+    callback = std::move(callback_);
+    callback_ = nullptr;
+    status_ = status;
+    busy_ = false;
+    return true;
+}
+
+// The callback runs with interrupts enabled and may start the next transfer
+void DMA_Transfer::finish(SPI_Error_Type status) {
+    Transfer_Callback callback;
+    {
+        cortex::Critical_Section section;
+        if (!take(status, callback)) {
+            return;
+        }
+    }
+    if (callback) {
+        callback(status);
+    }
+}
+
+} // namespace spi
@@ -0,0 +1,139 @@
+// gd32f30x SPI DMA transfers in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "DMA.hpp"
+#include "SPI.hpp"
+
+namespace spi {
+
+//
+// Full duplex SPI transfers on the paired RX and TX DMA channels of the
+// instance. Write-only transfers discard the received frames into a single
+// dummy word, read-only transfers clock out a fill value, in both cases
+// with the memory increment of the unused side turned off.
+//
+// The frame size follows FF16 in CTL0: the uint8_t overloads need 8-bit
+// frames and the uint16_t overloads 16-bit frames. The SPI must be
+// configured for full duplex and enabled. Chip select is up to the caller.
+//
+// Completion comes from the RX channel, since the last frame received
+// means the last clock has been sent. The application forwards both DMA
+// channel interrupts to handle_dma_interrupt(); callbacks run there.
+//
+// With CRC framing enabled every transfer is one CRC block: the hardware
+// appends the CRC frame after the last TX DMA frame and checks the one
+// received after the last RX frame, which the RX channel is re-armed to
+// take. A mismatch completes with CRC_ERROR.
+// Both ends must use the same polynomial and frame size.
+//
+class DMA_Transfer {
+public:
+    using Transfer_Callback = std::function<void(SPI_Error_Type status)>;
+
+    static constexpr uint16_t DefaultFill = 0xFFFF;
+
+    explicit DMA_Transfer(SPI& spi) : spi_(spi) {}
+
+    SPI_Error_Type begin();
+    void end();
+
+    // tx and rx must have the same size unless one of them is empty
+    SPI_Error_Type transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx, Transfer_Callback callback = nullptr) {
+        return start(tx.data(), rx.data(), tx.size(), rx.size(), false, fill_, callback);
+    }
+    SPI_Error_Type transfer(std::span<const uint16_t> tx, std::span<uint16_t> rx, Transfer_Callback callback = nullptr) {
+        return start(tx.data(), rx.data(), tx.size(), rx.size(), true, fill_, callback);
+    }
+    SPI_Error_Type write(std::span<const uint8_t> tx, Transfer_Callback callback = nullptr) {
+        return transfer(tx, std::span<uint8_t>(), callback);
+    }
+    SPI_Error_Type write(std::span<const uint16_t> tx, Transfer_Callback callback = nullptr) {
+        return transfer(tx, std::span<uint16_t>(), callback);
+    }
+    // Clock out the value from set_fill_value()
+    SPI_Error_Type read(std::span<uint8_t> rx, Transfer_Callback callback = nullptr) {
+        return transfer(std::span<const uint8_t>(), rx, callback);
+    }
+    SPI_Error_Type read(std::span<uint16_t> rx, Transfer_Callback callback = nullptr) {
+        return transfer(std::span<const uint16_t>(), rx, callback);
+    }
+    // Clock out fill for this transfer only
+    SPI_Error_Type read(std::span<uint8_t> rx, uint8_t fill, Transfer_Callback callback = nullptr) {
+        return start(nullptr, rx.data(), 0, rx.size(), false, fill, callback);
+    }
+    SPI_Error_Type read(std::span<uint16_t> rx, uint16_t fill, Transfer_Callback callback = nullptr) {
+        return start(nullptr, rx.data(), 0, rx.size(), true, fill, callback);
+    }
+
+    // Blocking variants, the deadline is in core cycles
+    SPI_Error_Type transfer_blocking(std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                                     uint32_t timeout_cycles = cortex::Deadline::Infinite);
+    SPI_Error_Type transfer_blocking(std::span<const uint16_t> tx, std::span<uint16_t> rx,
+                                     uint32_t timeout_cycles = cortex::Deadline::Infinite);
+
+    // Hardware CRC on every following transfer. Must be set while idle;
+    // SPI_Bus rewrites CTL0 and does not keep it.
+    SPI_Error_Type set_crc_framing(bool enable, uint16_t polynomial = 0x0007);
+    bool is_crc_framing() const {
+        return crc_enabled_;
+    }
+    // CRC frame that closed the last received block
+    uint16_t get_received_crc() const {
+        return received_crc_;
+    }
+    uint32_t get_crc_error_count() const {
+        return crc_errors_;
+    }
+
+    // Value clocked out when tx is empty
+    void set_fill_value(uint16_t fill) {
+        fill_ = fill;
+    }
+    bool is_busy() const {
+        return busy_;
+    }
+    // Stop a running transfer, its callback sees TIMEOUT
+    void abort();
+    // Stop a running transfer without running its callback, false if it
+    // had already completed
+    bool cancel();
+
+    // Call from the IRQ handlers of both the RX and TX DMA channels
+    void handle_dma_interrupt();
+
+private:
+    SPI& spi_;
+    dma::DMA* dma_ = nullptr;
+    Transfer_Callback callback_;
+    volatile bool busy_ = false;
+    volatile SPI_Error_Type status_ = SPI_Error_Type::OK;
+    uint16_t fill_ = DefaultFill;
+    uint16_t transfer_fill_ = DefaultFill;
+    uint16_t dummy_rx_ = 0;
+    bool crc_enabled_ = false;
+    bool crc_check_ = false;
+    // The RX channel is taking the CRC frame
+    bool crc_phase_ = false;
+    // Written by the RX channel
+    volatile uint16_t received_crc_ = 0;
+    volatile uint32_t crc_errors_ = 0;
+
+    SPI_Error_Type start(const void* tx, void* rx, size_t tx_count, size_t rx_count, bool wide, uint16_t fill,
+                         Transfer_Callback callback);
+    SPI_Error_Type wait(const cortex::Deadline& deadline);
+    void restart_crc();
+    void receive_crc();
+    SPI_Error_Type check_crc();
+    bool take(SPI_Error_Type status, Transfer_Callback& callback);
+    void finish(SPI_Error_Type status);
+};
+
+} // namespace spi
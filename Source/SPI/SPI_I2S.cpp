@@ -0,0 +1,182 @@
+// gd32f30x SPI I2S streaming in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "SPI_I2S.hpp"
+
+namespace spi {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+
+template <typename Bits>
+constexpr uint32_t field_value(Bits bits, uint32_t value) {
+    return (value << (static_cast<uint32_t>(bits) >> 16)) & bit_mask(bits);
+}
+
+SPI_Error_Type I2S_Stream::begin(const I2S_Config& config) {
+    if (!is_i2s_capable(spi_.base_index_)) {
+        return SPI_Error_Type::INVALID_SPI;
+    }
+    if (running_) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    config_ = config;
+    // 24 and 32-bit data need 32-bit channels
+    const bool channel_32bit = config.channel_32bit || (config.data_length != I2S_Data_Length::DATA_16BIT);
+    const bool master = (config.mode == I2S_Mode::MASTER_TX) || (config.mode == I2S_Mode::MASTER_RX);
+
+    uint32_t i2spsc = field_value(I2SPSC_Bits::DIV, MinimumI2SDivider);
+    clock_result_ = {};
+    if (master) {
+        const uint32_t i2s_clock = (config.clock_frequency != 0) ? config.clock_frequency :
+                                   RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_SYS);
+        clock_result_ = calculate_i2s_clock(i2s_clock, config.sample_rate, channel_32bit, config.mclk_output);
+        const uint32_t error = static_cast<uint32_t>((clock_result_.error_ppm < 0) ? -clock_result_.error_ppm : clock_result_.error_ppm);
+        if (!clock_result_.valid || ((config.tolerance_ppm != 0) && (error > config.tolerance_ppm))) {
+            return SPI_Error_Type::INVALID_SELECTION;
+        }
+        i2spsc = field_value(I2SPSC_Bits::DIV, clock_result_.divider) |
+                 field_value(I2SPSC_Bits::OF, clock_result_.odd ? Set : Clear) |
+                 field_value(I2SPSC_Bits::MCKOEN, config.mclk_output ? Set : Clear);
+    }
+
+    uint32_t standard;
+    switch (config.standard) {
+    case I2S_Standard::MSB:
+        standard = 1;
+        break;
+    case I2S_Standard::LSB:
+        standard = 2;
+        break;
+    case I2S_Standard::PCM_SHORT:
+    case I2S_Standard::PCM_LONG:
+        standard = 3;
+        break;
+    case I2S_Standard::PHILIPS:
+    default:
+        standard = 0;
+        break;
+    }
+    const uint32_t i2sctl = field_value(I2SCTL_Bits::I2SSEL, Set) |
+                            field_value(I2SCTL_Bits::I2SOPMOD, static_cast<uint32_t>(config.mode)) |
+                            field_value(I2SCTL_Bits::I2SSTD, standard) |
+                            field_value(I2SCTL_Bits::PCMSMOD, (config.standard == I2S_Standard::PCM_LONG) ? Set : Clear) |
+                            field_value(I2SCTL_Bits::CKPL, static_cast<uint32_t>(config.idle_polarity)) |
+                            field_value(I2SCTL_Bits::DTLEN, static_cast<uint32_t>(config.data_length)) |
+                            field_value(I2SCTL_Bits::CHLEN, channel_32bit ? Set : Clear);
+
+    // Settings only take effect with I2SEN cleared
+    write_register(spi_, SPI_Regs::I2SCTL, 0U);
+    write_register(spi_, SPI_Regs::I2SPSC, i2spsc);
+    write_register(spi_, SPI_Regs::I2SCTL, i2sctl);
+
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    auto dma_result = dma::DMA::get_instance(channels.dma_base);
+    if (dma_result.error() != dma::DMA_Error_Type::OK) {
+        return SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    dma_ = &dma_result.value();
+    channel_ = is_transmit() ? channels.tx_channel : channels.rx_channel;
+
+    dma::DMA_Config dma_config = {
+        .peripheral_address = reinterpret_cast<uint32_t>(spi_.reg_address(SPI_Regs::DATA)),
+        .peripheral_bit_width = dma::Bit_Width::WIDTH_16BIT,
+        .memory_address = 0,
+        .memory_bit_width = dma::Bit_Width::WIDTH_16BIT,
+        .count = 0,
+        .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+        .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+        .channel_priority = dma::Channel_Priority::ULTRA_HIGH_PRIORITY,
+        .direction = is_transmit() ? dma::Transfer_Direction::M2P : dma::Transfer_Direction::P2M,
+    };
+    dma_->reset(channel_);
+    dma_->configure(channel_, dma_config);
+    dma_->set_circulation_mode_enable(channel_, true);
+    dma_->set_interrupt_enable(channel_, dma::Interrupt_Type::INTR_HTFIE, true);
+    dma_->set_interrupt_enable(channel_, dma::Interrupt_Type::INTR_FTFIE, true);
+    dma_->set_interrupt_enable(channel_, dma::Interrupt_Type::INTR_ERRIE, true);
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channel_));
+
+    return SPI_Error_Type::OK;
+}
+
+void I2S_Stream::end() {
+    stop();
+    write_register(spi_, SPI_Regs::I2SCTL, 0U);
+    dma_ = nullptr;
+}
+
+//
+// For transmit the whole buffer should hold valid samples before start(),
+// the first callback comes after the first half has been sent.
+//
+SPI_Error_Type I2S_Stream::start(std::span<uint16_t> buffer, Half_Callback callback) {
+    if ((dma_ == nullptr) || running_) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    if ((buffer.size() < 4) || ((buffer.size() & 1U) != 0) || (buffer.size() > MaximumTransferCount)) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    buffer_ = buffer;
+    callback_ = callback;
+    missed_halves_ = 0;
+    dma_errors_ = 0;
+
+    dma_->set_channel_enable(channel_, false);
+    dma_->clear_flags(dma::channel_all_flags_mask(channel_));
+    dma_->set_data_address(channel_, dma::Data_Type::MEMORY_ADDRESS, reinterpret_cast<uint32_t>(buffer.data()));
+    dma_->set_transfer_count(channel_, static_cast<uint32_t>(buffer.size()));
+    dma_->set_channel_enable(channel_, true);
+
+    // A stale frame would shift the receive stream by one half-word
+    read_register<uint32_t>(spi_, SPI_Regs::DATA);
+    read_register<uint32_t>(spi_, SPI_Regs::STAT);
+
+    running_ = true;
+    spi_.set_dma_enable(is_transmit() ? DMA_Direction::DMA_TX : DMA_Direction::DMA_RX, true);
+    write_bit(spi_, SPI_Regs::I2SCTL, static_cast<uint32_t>(I2SCTL_Bits::I2SEN), Set);
+
+    return SPI_Error_Type::OK;
+}
+
+void I2S_Stream::stop() {
+    if ((dma_ == nullptr) || !running_) {
+        return;
+    }
+    running_ = false;
+    write_bit(spi_, SPI_Regs::I2SCTL, static_cast<uint32_t>(I2SCTL_Bits::I2SEN), Clear);
+    spi_.set_dma_enable(is_transmit() ? DMA_Direction::DMA_TX : DMA_Direction::DMA_RX, false);
+    dma_->set_channel_enable(channel_, false);
+    dma_->clear_flags(dma::channel_all_flags_mask(channel_));
+}
+
+void I2S_Stream::handle_dma_interrupt() {
+    if ((dma_ == nullptr) || !running_) {
+        return;
+    }
+    const dma::DMA_Status_Snapshot status = dma_->get_interrupt_snapshot(1U << static_cast<uint32_t>(channel_));
+    dma_->clear_flags(status.flags);
+
+    if (status.test(channel_, dma::Status_Flags::FLAG_ERRIF)) {
+        dma_errors_ = dma_errors_ + 1;
+        stop();
+        return;
+    }
+
+    const bool half = status.test(channel_, dma::Status_Flags::FLAG_HTFIF);
+    const bool full = status.test(channel_, dma::Status_Flags::FLAG_FTFIF);
+    if (!half && !full) {
+        return;
+    }
+    // Both pending means a whole half went by unserviced, only the one DMA
+    // finished last can still be handed out safely
+    if (half && full) {
+        missed_halves_ = missed_halves_ + 1;
+    }
+    const size_t half_size = buffer_.size() / 2;
+    if (callback_) {
+        callback_(full ? buffer_.subspan(half_size) : buffer_.first(half_size));
+    }
+}
+
+} // namespace spi
@@ -0,0 +1,82 @@
+// gd32f30x SPI I2S streaming in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "DMA.hpp"
+#include "SPI.hpp"
+
+namespace spi {
+
+//
+// I2S master or slave, transmit or receive, on SPI1 or SPI2. Samples are
+// streamed by one DMA channel in circular mode over a caller owned buffer
+// split in two halves: while DMA works on one half the callback gets the
+// other one, to refill for transmit or to consume for receive. The stream
+// has no gaps as long as each callback returns within half a buffer.
+//
+// DATA is 16 bits wide, so 24 and 32-bit samples occupy two half-words,
+// most significant first. Stereo frames alternate left and right.
+//
+// WS, CK and SD are the NSS, SCK and MOSI pins of the SPI and are set up
+// with SPI::pins_configure(); MCK has to be configured by the caller when
+// used. The application forwards the DMA channel interrupt to
+// handle_dma_interrupt().
+//
+class I2S_Stream {
+public:
+    using Half_Callback = std::function<void(std::span<uint16_t> half)>;
+
+    explicit I2S_Stream(SPI& spi) : spi_(spi) {}
+
+    static constexpr bool is_i2s_capable(SPI_Base base) {
+        return (base == SPI_Base::SPI1_BASE) || (base == SPI_Base::SPI2_BASE);
+    }
+
+    SPI_Error_Type begin(const I2S_Config& config);
+    void end();
+
+    // buffer must hold an even number of half-words, at least two frames
+    SPI_Error_Type start(std::span<uint16_t> buffer, Half_Callback callback);
+    void stop();
+
+    bool is_running() const {
+        return running_;
+    }
+    I2S_Clock_Result get_clock_result() const {
+        return clock_result_;
+    }
+    // Halves that came back before the callback for the previous one ran
+    uint32_t get_missed_half_count() const {
+        return missed_halves_;
+    }
+    uint32_t get_dma_error_count() const {
+        return dma_errors_;
+    }
+
+    // Call from the DMA channel IRQ handler
+    void handle_dma_interrupt();
+
+private:
+    SPI& spi_;
+    dma::DMA* dma_ = nullptr;
+    dma::DMA_Channel channel_ = dma::DMA_Channel::CHANNEL0;
+    I2S_Config config_ = {};
+    I2S_Clock_Result clock_result_ = {};
+    std::span<uint16_t> buffer_;
+    Half_Callback callback_;
+    volatile bool running_ = false;
+    volatile uint32_t missed_halves_ = 0;
+    volatile uint32_t dma_errors_ = 0;
+
+    bool is_transmit() const {
+        return (config_.mode == I2S_Mode::MASTER_TX) || (config_.mode == I2S_Mode::SLAVE_TX);
+    }
+};
+
+} // namespace spi
@@ -0,0 +1,442 @@
+// gd32f30x SPI0 quad mode NOR flash in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <algorithm>
+
+#include "SPI_NOR_Flash.hpp"
+
+namespace spi {
+
+namespace {
+
+constexpr uint8_t CommandWriteEnable = 0x06;
+constexpr uint8_t CommandReadStatus1 = 0x05;
+constexpr uint8_t CommandReadStatus2 = 0x35;
+constexpr uint8_t CommandWriteStatus2 = 0x31;
+constexpr uint8_t CommandJedecId = 0x9F;
+constexpr uint8_t CommandFastRead = 0x0B;
+constexpr uint8_t CommandQuadOutputRead = 0x6B;
+constexpr uint8_t CommandQuadIORead = 0xEB;
+// TRANS outlasts the last received frame by well under a frame time: 8 bits
+// at PCLK / 256 with PCLK at half the core clock, plus margin
+constexpr uint32_t LaneSwitchCycles = 16384;
+constexpr uint8_t CommandPageProgram = 0x02;
+constexpr uint8_t CommandQuadPageProgram = 0x32;
+constexpr uint8_t CommandSectorErase = 0x20;
+constexpr uint8_t CommandBlockErase32K = 0x52;
+constexpr uint8_t CommandBlockErase64K = 0xD8;
+constexpr uint8_t CommandChipErase = 0xC7;
+
+constexpr uint8_t Status1Busy = 0x01;
+constexpr uint8_t Status2QuadEnable = 0x02;
+
+constexpr size_t MaximumChunk = 0xFFFF;
+
+} // namespace
+
+SPI_Error_Type NOR_Flash::begin(const NOR_Flash_Config& config, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    if (spi_.base_index_ != SPI_Base::SPI0_BASE) {
+        return SPI_Error_Type::INVALID_SPI;
+    }
+    auto cs_result = gpio::GPIO::get_instance(config.cs_port);
+    auto io2_result = gpio::GPIO::get_instance(config.io2_pin.gpio_port);
+    auto io3_result = gpio::GPIO::get_instance(config.io3_pin.gpio_port);
+    if ((cs_result.error() != gpio::GPIO_Error_Type::OK) || (io2_result.error() != gpio::GPIO_Error_Type::OK) ||
+            (io3_result.error() != gpio::GPIO_Error_Type::OK)) {
+        return SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    config_ = config;
+
+    gpio::GPIO& cs_port = cs_result.value();
+    cs_mask_ = 1U << static_cast<uint32_t>(config.cs_pin);
+    cs_select_reg_ = cs_port.reg_address(gpio::GPIO_Regs::BC);
+    cs_release_reg_ = cs_port.reg_address(gpio::GPIO_Regs::BOP);
+    deselect();
+    cs_port.init_pin(config.cs_pin, gpio::Pin_Mode::OUTPUT_PUSHPULL, gpio::Output_Speed::SPEED_50MHZ);
+    io2_result.value().init_pin(config.io2_pin.pin, config.io2_pin.mode, config.io2_pin.speed);
+    io3_result.value().init_pin(config.io3_pin.pin, config.io3_pin.mode, config.io3_pin.speed);
+    set_lanes(Lanes::SINGLE);
+
+    SPI_Error_Type result = dma_.begin();
+    if (result != SPI_Error_Type::OK) {
+        return result;
+    }
+    read_busy_ = false;
+    started_ = true;
+
+    Flash_JEDEC_ID id = {};
+    result = read_jedec_id(id, deadline.remaining());
+    // No device answers all zeros or all ones
+    if ((result == SPI_Error_Type::OK) &&
+            ((id.manufacturer == 0x00) || (id.manufacturer == 0xFF) || (id.capacity < 10) || (id.capacity > 31))) {
+        result = SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    if (result == SPI_Error_Type::OK) {
+        size_ = std::min(1U << id.capacity, MaximumSize);
+        if ((config.read_mode != Flash_Read_Mode::READ_1_1_1) || config.quad_program) {
+            result = enable_quad(deadline);
+        }
+    }
+    if (result != SPI_Error_Type::OK) {
+        end();
+    }
+    return result;
+}
+
+void NOR_Flash::end() {
+    if (!started_) {
+        return;
+    }
+    dma_.end();
+    set_lanes(Lanes::SINGLE);
+    deselect();
+    read_busy_ = false;
+    started_ = false;
+}
+
+SPI_Error_Type NOR_Flash::read_jedec_id(Flash_JEDEC_ID& id, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+    const uint8_t opcode = CommandJedecId;
+    std::array<uint8_t, 3> response = {};
+
+    SPI_Error_Type result = command(std::span<const uint8_t>(&opcode, 1), std::span<const uint8_t>(), response, deadline);
+    if (result == SPI_Error_Type::OK) {
+        id = Flash_JEDEC_ID{response[0], response[1], response[2]};
+    }
+    return result;
+}
+
+SPI_Error_Type NOR_Flash::read(uint32_t address, std::span<uint8_t> data, uint32_t timeout_cycles) {
+    SPI_Error_Type result = read_async(address, data);
+    if (result != SPI_Error_Type::OK) {
+        return result;
+    }
+    return wait_idle(timeout_cycles);
+}
+
+//
+// The read is a chain of DMA transfers under one chip select, each started
+// from the completion of the previous one: opcode (and for 1-1-x the
+// address and dummy byte), for 1-4-4 the address, mode and dummy clocks in
+// quad write, then the data in 64 KB chunks.
+//
+SPI_Error_Type NOR_Flash::read_async(uint32_t address, std::span<uint8_t> data, Read_Callback callback) {
+    if (!started_ || is_busy()) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    if (data.empty() || (address >= size_) || (data.size() > (size_ - address))) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    read_busy_ = true;
+    read_status_ = SPI_Error_Type::OK;
+    read_data_ = data;
+    read_callback_ = callback;
+    read_phase_ = Read_Phase::COMMAND;
+
+    size_t length;
+    switch (config_.read_mode) {
+    case Flash_Read_Mode::READ_1_4_4:
+        header_[0] = CommandQuadIORead;
+        length = 1;
+        break;
+    case Flash_Read_Mode::READ_1_1_4:
+        length = build_header(CommandQuadOutputRead, address, 1);
+        break;
+    case Flash_Read_Mode::READ_1_1_1:
+    default:
+        length = build_header(CommandFastRead, address, 1);
+        break;
+    }
+    // Sent in the ADDRESS phase for 1-4-4
+    read_address_ = address;
+
+    select();
+    SPI_Error_Type result = set_lanes(Lanes::SINGLE);
+    if (result == SPI_Error_Type::OK) {
+        result = dma_.write(std::span<const uint8_t>(header_.data(), length), [this](SPI_Error_Type status) {
+            read_step(status);
+        });
+    }
+    if (result != SPI_Error_Type::OK) {
+        // Reported through the return value only
+        read_callback_ = nullptr;
+        finish_read(result);
+    }
+    return result;
+}
+
+void NOR_Flash::read_step(SPI_Error_Type status) {
+    if (status != SPI_Error_Type::OK) {
+        finish_read(status);
+        return;
+    }
+    auto next = [this](SPI_Error_Type next_status) {
+        read_step(next_status);
+    };
+
+    if ((read_phase_ == Read_Phase::COMMAND) && (config_.read_mode == Flash_Read_Mode::READ_1_4_4)) {
+        // Address, mode byte 0x00 (no continuous read) and four dummy clocks
+        read_phase_ = Read_Phase::ADDRESS;
+        header_[0] = static_cast<uint8_t>(read_address_ >> 16);
+        header_[1] = static_cast<uint8_t>(read_address_ >> 8);
+        header_[2] = static_cast<uint8_t>(read_address_);
+        header_[3] = 0x00;
+        header_[4] = 0x00;
+        header_[5] = 0x00;
+        status = set_lanes(Lanes::QUAD_WRITE);
+        if (status == SPI_Error_Type::OK) {
+            status = dma_.write(std::span<const uint8_t>(header_.data(), 6), next);
+        }
+    } else if (read_data_.empty()) {
+        finish_read(SPI_Error_Type::OK);
+        return;
+    } else {
+        if (read_phase_ != Read_Phase::DATA) {
+            read_phase_ = Read_Phase::DATA;
+            status = set_lanes((config_.read_mode == Flash_Read_Mode::READ_1_1_1) ? Lanes::SINGLE : Lanes::QUAD_READ);
+        }
+        if (status == SPI_Error_Type::OK) {
+            const size_t chunk = std::min(read_data_.size(), MaximumChunk);
+            const std::span<uint8_t> part = read_data_.first(chunk);
+            read_data_ = read_data_.subspan(chunk);
+            status = dma_.read(part, 0xFF, next);
+        }
+    }
+    if (status != SPI_Error_Type::OK) {
+        finish_read(status);
+    }
+}
+
+void NOR_Flash::finish_read(SPI_Error_Type status) {
+    const SPI_Error_Type lanes_status = set_lanes(Lanes::SINGLE);
+    if (status == SPI_Error_Type::OK) {
+        status = lanes_status;
+    }
+    deselect();
+    const Read_Callback callback = std::move(read_callback_);
+    read_callback_ = nullptr;
+    read_status_ = status;
+    read_busy_ = false;
+    if (callback) {
+        callback(status);
+    }
+}
+
+SPI_Error_Type NOR_Flash::wait_idle(uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    while (read_busy_) {
+        if (deadline.expired()) {
+            cortex::Critical_Section section;
+            if (read_busy_) {
+                // Ends the chain through read_step()
+                dma_.abort();
+                if (read_busy_) {
+                    finish_read(SPI_Error_Type::TIMEOUT);
+                }
+            }
+            return SPI_Error_Type::TIMEOUT;
+        }
+    }
+    return read_status_;
+}
+
+SPI_Error_Type NOR_Flash::program(uint32_t address, std::span<const uint8_t> data, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    if (!started_ || is_busy()) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    if ((address >= size_) || (data.size() > (size_ - address))) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+
+    const uint8_t opcode = config_.quad_program ? CommandQuadPageProgram : CommandPageProgram;
+    while (!data.empty()) {
+        // A page program wraps inside the page, never cross its end
+        const size_t chunk = std::min<size_t>(data.size(), PageSize - (address % PageSize));
+
+        SPI_Error_Type result = write_enable(deadline);
+        if (result == SPI_Error_Type::OK) {
+            const size_t length = build_header(opcode, address, 0);
+            result = command(std::span<const uint8_t>(header_.data(), length), data.first(chunk), std::span<uint8_t>(),
+                             deadline, config_.quad_program);
+        }
+        if (result == SPI_Error_Type::OK) {
+            result = wait_ready(deadline);
+        }
+        if (result != SPI_Error_Type::OK) {
+            return result;
+        }
+        address += static_cast<uint32_t>(chunk);
+        data = data.subspan(chunk);
+    }
+    return SPI_Error_Type::OK;
+}
+
+SPI_Error_Type NOR_Flash::erase(uint32_t address, Flash_Erase_Size size, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    if (!started_ || is_busy()) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    if (address >= size_) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+
+    SPI_Error_Type result = write_enable(deadline);
+    if (result != SPI_Error_Type::OK) {
+        return result;
+    }
+    size_t length;
+    switch (size) {
+    case Flash_Erase_Size::SECTOR_4K:
+        length = build_header(CommandSectorErase, address & ~(SectorSize - 1), 0);
+        break;
+    case Flash_Erase_Size::BLOCK_32K:
+        length = build_header(CommandBlockErase32K, address & ~0x7FFFU, 0);
+        break;
+    case Flash_Erase_Size::BLOCK_64K:
+        length = build_header(CommandBlockErase64K, address & ~0xFFFFU, 0);
+        break;
+    case Flash_Erase_Size::CHIP:
+    default:
+        header_[0] = CommandChipErase;
+        length = 1;
+        break;
+    }
+    result = command(std::span<const uint8_t>(header_.data(), length), std::span<const uint8_t>(), std::span<uint8_t>(), deadline);
+    if (result != SPI_Error_Type::OK) {
+        return result;
+    }
+    return wait_ready(deadline);
+}
+
+SPI_Error_Type NOR_Flash::wait_ready(const cortex::Deadline& deadline) {
+    const uint8_t opcode = CommandReadStatus1;
+    uint8_t status = 0;
+
+    while (true) {
+        SPI_Error_Type result = command(std::span<const uint8_t>(&opcode, 1), std::span<const uint8_t>(),
+                                        std::span<uint8_t>(&status, 1), deadline);
+        if (result != SPI_Error_Type::OK) {
+            return result;
+        }
+        if ((status & Status1Busy) == 0) {
+            return SPI_Error_Type::OK;
+        }
+        if (deadline.expired()) {
+            return SPI_Error_Type::TIMEOUT;
+        }
+    }
+}
+
+// Only touched between frames: the last received byte means TRANS is about
+// to clear, wait for it before the data lines change direction. Reached from
+// the DMA interrupt, so the wait is bounded; the lanes stay as they were on
+// TIMEOUT.
+SPI_Error_Type NOR_Flash::set_lanes(Lanes lanes) {
+    const cortex::Deadline deadline(LaneSwitchCycles);
+    while ((read_register<uint32_t>(spi_, SPI_Regs::STAT) & bit_mask(STAT_Bits::TRANS)) != 0) {
+        if (deadline.expired()) {
+            return SPI_Error_Type::TIMEOUT;
+        }
+    }
+    uint32_t qctl;
+    switch (lanes) {
+    case Lanes::QUAD_WRITE:
+        qctl = bit_mask(QCTL_Bits::QMOD);
+        break;
+    case Lanes::QUAD_READ:
+        qctl = bit_mask(QCTL_Bits::QMOD) | bit_mask(QCTL_Bits::QRD);
+        break;
+    case Lanes::SINGLE:
+    default:
+        qctl = bit_mask(QCTL_Bits::IO23_DRV);
+        break;
+    }
+    write_register(spi_, SPI_Regs::QCTL, qctl);
+    return SPI_Error_Type::OK;
+}
+
+SPI_Error_Type NOR_Flash::run(std::span<const uint8_t> tx, std::span<uint8_t> rx, const cortex::Deadline& deadline) {
+    if (tx.empty() && rx.empty()) {
+        return SPI_Error_Type::OK;
+    }
+    return dma_.transfer_blocking(tx, rx, deadline.remaining());
+}
+
+SPI_Error_Type NOR_Flash::command(std::span<const uint8_t> header, std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                                  const cortex::Deadline& deadline, bool quad_data) {
+    if (!started_ || is_busy()) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    select();
+    SPI_Error_Type result = run(header, std::span<uint8_t>(), deadline);
+    if ((result == SPI_Error_Type::OK) && (!tx.empty() || !rx.empty())) {
+        if (quad_data) {
+            result = set_lanes(tx.empty() ? Lanes::QUAD_READ : Lanes::QUAD_WRITE);
+        }
+        if (result == SPI_Error_Type::OK) {
+            result = run(tx, rx, deadline);
+        }
+        if (quad_data) {
+            const SPI_Error_Type lanes_result = set_lanes(Lanes::SINGLE);
+            if (result == SPI_Error_Type::OK) {
+                result = lanes_result;
+            }
+        }
+    }
+    deselect();
+    return result;
+}
+
+SPI_Error_Type NOR_Flash::write_enable(const cortex::Deadline& deadline) {
+    const uint8_t opcode = CommandWriteEnable;
+    return command(std::span<const uint8_t>(&opcode, 1), std::span<const uint8_t>(), std::span<uint8_t>(), deadline);
+}
+
+SPI_Error_Type NOR_Flash::enable_quad(const cortex::Deadline& deadline) {
+    const uint8_t read_opcode = CommandReadStatus2;
+    uint8_t status2 = 0;
+
+    SPI_Error_Type result = command(std::span<const uint8_t>(&read_opcode, 1), std::span<const uint8_t>(),
+                                    std::span<uint8_t>(&status2, 1), deadline);
+    if ((result != SPI_Error_Type::OK) || ((status2 & Status2QuadEnable) != 0)) {
+        return result;
+    }
+
+    const std::array<uint8_t, 2> write_status = {CommandWriteStatus2, static_cast<uint8_t>(status2 | Status2QuadEnable)};
+    result = write_enable(deadline);
+    if (result == SPI_Error_Type::OK) {
+        result = command(write_status, std::span<const uint8_t>(), std::span<uint8_t>(), deadline);
+    }
+    if (result == SPI_Error_Type::OK) {
+        result = wait_ready(deadline);
+    }
+    if (result == SPI_Error_Type::OK) {
+        result = command(std::span<const uint8_t>(&read_opcode, 1), std::span<const uint8_t>(),
+                         std::span<uint8_t>(&status2, 1), deadline);
+    }
+    if ((result == SPI_Error_Type::OK) && ((status2 & Status2QuadEnable) == 0)) {
+        // Part without a writable QE at this location
+        result = SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    return result;
+}
+
+size_t NOR_Flash::build_header(uint8_t opcode, uint32_t address, size_t dummy_bytes) {
+    header_[0] = opcode;
+    header_[1] = static_cast<uint8_t>(address >> 16);
+    header_[2] = static_cast<uint8_t>(address >> 8);
+    header_[3] = static_cast<uint8_t>(address);
+    for (size_t i = 0; i < dummy_bytes; ++i) {
+        header_[4 + i] = 0xFF;
+    }
+    return 4 + dummy_bytes;
+}
+
+} // namespace spi
@@ -0,0 +1,121 @@
+// gd32f30x SPI0 quad mode NOR flash in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "SPI_DMA.hpp"
+
+namespace spi {
+
+//
+// Serial NOR flash on SPI0, the only instance with quad mode. Command and
+// address go out on one lane, the data (1-1-4) or address and data (1-4-4)
+// over IO0-IO3 with QCTL switched between quad write and quad read. Outside
+// quad phases IO2/IO3 are driven high so WP# and HOLD# stay inactive.
+//
+// All transfers use DMA_Transfer, so reads of any length cost a couple of
+// interrupts per 64 KB. Reads can run in the background with read_async(),
+// e.g. to fetch the next block while the current one is processed.
+//
+// Command set and the QE bit (status register 2, bit 1, written with 0x31)
+// follow the Winbond/GigaDevice parts; addressing is 3 bytes, 16 MB. Program
+// and erase block the caller but wait with a deadline instead of a fixed
+// delay. The application forwards both DMA channel interrupts to
+// handle_dma_interrupt().
+//
+class NOR_Flash {
+public:
+    using Read_Callback = std::function<void(SPI_Error_Type status)>;
+
+    static constexpr uint32_t PageSize = 256;
+    static constexpr uint32_t SectorSize = 4096;
+    static constexpr uint32_t MaximumSize = 1U << 24;
+
+    explicit NOR_Flash(SPI& spi) : spi_(spi), dma_(spi) {}
+
+    // Probes the JEDEC ID and sets QE when a quad mode is used
+    SPI_Error_Type begin(const NOR_Flash_Config& config, uint32_t timeout_cycles);
+    void end();
+
+    SPI_Error_Type read_jedec_id(Flash_JEDEC_ID& id, uint32_t timeout_cycles = cortex::Deadline::Infinite);
+    uint32_t get_size() const {
+        return size_;
+    }
+
+    // Reads stream across page and sector boundaries without a new command
+    SPI_Error_Type read(uint32_t address, std::span<uint8_t> data, uint32_t timeout_cycles = cortex::Deadline::Infinite);
+    // Buffer must stay valid until the callback, which runs in interrupt context
+    SPI_Error_Type read_async(uint32_t address, std::span<uint8_t> data, Read_Callback callback = nullptr);
+    SPI_Error_Type wait_idle(uint32_t timeout_cycles);
+
+    // Split at page boundaries, each page polled for completion
+    SPI_Error_Type program(uint32_t address, std::span<const uint8_t> data, uint32_t timeout_cycles);
+    // address is rounded down to the erase size
+    SPI_Error_Type erase(uint32_t address, Flash_Erase_Size size, uint32_t timeout_cycles);
+    SPI_Error_Type wait_ready(const cortex::Deadline& deadline);
+
+    bool is_busy() const {
+        return read_busy_ || dma_.is_busy();
+    }
+
+    // Call from the IRQ handlers of both the RX and TX DMA channels
+    void handle_dma_interrupt() {
+        dma_.handle_dma_interrupt();
+    }
+
+private:
+    enum class Lanes {
+        SINGLE,
+        QUAD_WRITE,
+        QUAD_READ,
+    };
+
+    enum class Read_Phase {
+        COMMAND,
+        ADDRESS,
+        DATA,
+    };
+
+    SPI& spi_;
+    DMA_Transfer dma_;
+    NOR_Flash_Config config_ = {};
+    volatile uint32_t *cs_select_reg_ = nullptr;
+    volatile uint32_t *cs_release_reg_ = nullptr;
+    uint32_t cs_mask_ = 0;
+    uint32_t size_ = 0;
+    bool started_ = false;
+
+    // Background read state
+    std::array<uint8_t, 8> header_ = {};
+    std::span<uint8_t> read_data_;
+    uint32_t read_address_ = 0;
+    Read_Callback read_callback_;
+    Read_Phase read_phase_ = Read_Phase::COMMAND;
+    volatile bool read_busy_ = false;
+    volatile SPI_Error_Type read_status_ = SPI_Error_Type::OK;
+
+    void select() {
+        *cs_select_reg_ = cs_mask_;
+    }
+    void deselect() {
+        *cs_release_reg_ = cs_mask_;
+    }
+    SPI_Error_Type set_lanes(Lanes lanes);
+    SPI_Error_Type run(std::span<const uint8_t> tx, std::span<uint8_t> rx, const cortex::Deadline& deadline);
+    SPI_Error_Type command(std::span<const uint8_t> header, std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                           const cortex::Deadline& deadline, bool quad_data = false);
+    SPI_Error_Type write_enable(const cortex::Deadline& deadline);
+    SPI_Error_Type enable_quad(const cortex::Deadline& deadline);
+    size_t build_header(uint8_t opcode, uint32_t address, size_t dummy_bytes);
+    void read_step(SPI_Error_Type status);
+    void finish_read(SPI_Error_Type status);
+};
+
+} // namespace spi
@@ -0,0 +1,224 @@
+// gd32f30x SPI slave transport in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <algorithm>
+
+#include "CORTEX.hpp"
+#include "SPI_Slave.hpp"
+
+namespace spi {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+// Sent for the whole transaction while no response is set
+constexpr uint8_t FillByte = 0xFF;
+
+static IRQn_Type exti_irq_number(uint32_t pin) {
+    if (pin <= 4) {
+        return static_cast<IRQn_Type>(static_cast<uint32_t>(EXTI0_IRQn) + pin);
+    }
+    return (pin <= 9) ? EXTI5_9_IRQn : EXTI10_15_IRQn;
+}
+
+SPI_Error_Type Slave_Transport::begin(const SPI_Slave_Config& config, std::span<uint8_t> rx_ring,
+                                      std::span<const uint8_t> response, Frame_Callback callback) {
+    const uint32_t ctl0 = read_register<uint32_t>(spi_, SPI_Regs::CTL0);
+    if ((ctl0 & (bit_mask(CTL0_Bits::MSTMOD) | bit_mask(CTL0_Bits::FF16) | bit_mask(CTL0_Bits::RO) | bit_mask(CTL0_Bits::BDEN))) != 0) {
+        return SPI_Error_Type::INVALID_OPERATION;
+    }
+    if (rx_ring.empty() || ((rx_ring.size() % 2) != 0) || (rx_ring.size() > MaximumTransferCount) ||
+            (response.size() > MaximumTransferCount)) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    auto dma_result = dma::DMA::get_instance(channels.dma_base);
+    if (dma_result.error() != dma::DMA_Error_Type::OK) {
+        return SPI_Error_Type::INITIALIZATION_FAILED;
+    }
+    dma_ = &dma_result.value();
+
+    ring_ = rx_ring;
+    frame_start_ = 0;
+    halves_ = 0;
+    response_ = response;
+    response_pending_ = false;
+    callback_ = callback;
+    frames_ = 0;
+    overruns_ = 0;
+    underruns_ = 0;
+
+    dma::DMA_Config rx_config = {
+        .peripheral_address = reinterpret_cast<uint32_t>(spi_.reg_address(SPI_Regs::DATA)),
+        .peripheral_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .memory_address = reinterpret_cast<uint32_t>(rx_ring.data()),
+        .memory_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .count = static_cast<uint32_t>(rx_ring.size()),
+        .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+        .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+        .channel_priority = dma::Channel_Priority::ULTRA_HIGH_PRIORITY,
+        .direction = dma::Transfer_Direction::P2M,
+    };
+    dma::DMA_Config tx_config = rx_config;
+    tx_config.memory_address = 0;
+    tx_config.count = 0;
+    tx_config.channel_priority = dma::Channel_Priority::HIGH_PRIORITY;
+    tx_config.direction = dma::Transfer_Direction::M2P;
+
+    dma_->reset(channels.rx_channel);
+    dma_->configure(channels.rx_channel, rx_config);
+    dma_->set_circulation_mode_enable(channels.rx_channel, true);
+    dma_->set_interrupt_enable(channels.rx_channel, dma::Interrupt_Type::INTR_HTFIE, true);
+    dma_->set_interrupt_enable(channels.rx_channel, dma::Interrupt_Type::INTR_FTFIE, true);
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channels.rx_channel));
+    dma_->set_channel_enable(channels.rx_channel, true);
+    dma_->reset(channels.tx_channel);
+    dma_->configure(channels.tx_channel, tx_config);
+
+    spi_.set_dma_enable(DMA_Direction::DMA_RX, true);
+    rearm();
+
+    // End of transaction on the NSS rising edge
+    const uint32_t pin = static_cast<uint32_t>(config.nss_pin);
+    line_ = static_cast<exti::EXTI_Line>(REG_BIT_DEF(pin, pin));
+    AFIO_DEVICE.set_exti_source(static_cast<gpio::Source_Port>(config.nss_port), config.nss_pin);
+    EXTI_DEVICE.init(line_, exti::EXTI_Mode::EXTI_INTERRUPT, exti::EXTI_Trigger::TRIG_RISING);
+    EXTI_DEVICE.clear_interrupt_flag(line_);
+    NVIC_EnableIRQ(exti_irq_number(pin));
+
+    return SPI_Error_Type::OK;
+}
+
+void Slave_Transport::end() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    EXTI_DEVICE.set_interrupt_enable(line_, false);
+    spi_.set_dma_enable(DMA_Direction::DMA_TX, false);
+    spi_.set_dma_enable(DMA_Direction::DMA_RX, false);
+    dma_->set_channel_enable(channels.tx_channel, false);
+    dma_->set_channel_enable(channels.rx_channel, false);
+    dma_ = nullptr;
+}
+
+SPI_Error_Type Slave_Transport::set_response(std::span<const uint8_t> response) {
+    if (response.size() > MaximumTransferCount) {
+        return SPI_Error_Type::INVALID_SELECTION;
+    }
+    cortex::Critical_Section section;
+    pending_response_ = response;
+    response_pending_ = true;
+    return SPI_Error_Type::OK;
+}
+
+void Slave_Transport::handle_dma_interrupt() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    count_halves();
+}
+
+void Slave_Transport::count_halves() {
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    cortex::Critical_Section section;
+    const dma::DMA_Status_Snapshot status = dma_->get_interrupt_snapshot(1U << static_cast<uint32_t>(channels.rx_channel));
+    dma_->clear_flags(status.flags);
+    const uint32_t passed = (status.test(channels.rx_channel, dma::Status_Flags::FLAG_HTFIF) ? 1U : 0U) +
+                            (status.test(channels.rx_channel, dma::Status_Flags::FLAG_FTFIF) ? 1U : 0U);
+    halves_ = halves_ + passed;
+}
+
+// Circular CNT reloads to the ring size, so size - CNT is the next write index
+size_t Slave_Transport::ring_position() {
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    const size_t remaining = dma_->get_transfer_count(channels.rx_channel);
+    return (ring_.size() - remaining) % ring_.size();
+}
+
+//
+// The SPI reset drops the byte TX DMA already loaded into DATA for the
+// next transaction that would otherwise go out first. The RX channel keeps
+// running through it, only the requests are re-enabled.
+//
+void Slave_Transport::rearm() {
+    const SPI_DMA_Channels& channels = SPI_dma_index[static_cast<int>(spi_.base_index_)];
+    const dma::DMA_Channel tx_channel = channels.tx_channel;
+    const uint32_t ctl0 = read_register<uint32_t>(spi_, SPI_Regs::CTL0);
+    const uint32_t ctl1 = read_register<uint32_t>(spi_, SPI_Regs::CTL1);
+    const uint16_t polynomial = spi_.get_crc_polynomial();
+
+    dma_->set_channel_enable(tx_channel, false);
+    spi_.reset();
+    spi_.set_crc_polynomial(polynomial);
+    write_register(spi_, SPI_Regs::CTL1, (ctl1 & ~bit_mask(CTL1_Bits::DMATEN)) | bit_mask(CTL1_Bits::DMAREN));
+    write_register(spi_, SPI_Regs::CTL0, ctl0 & ~bit_mask(CTL0_Bits::SPIEN));
+
+    dma_->clear_flags(dma::channel_all_flags_mask(tx_channel));
+    if (response_.empty()) {
+        dma_->set_data_address(tx_channel, dma::Data_Type::MEMORY_ADDRESS, reinterpret_cast<uint32_t>(&FillByte));
+        dma_->set_increase_mode_enable(tx_channel, dma::Data_Type::MEMORY_ADDRESS, false);
+        dma_->set_transfer_count(tx_channel, static_cast<uint32_t>(MaximumTransferCount));
+    } else {
+        dma_->set_data_address(tx_channel, dma::Data_Type::MEMORY_ADDRESS, reinterpret_cast<uint32_t>(response_.data()));
+        dma_->set_increase_mode_enable(tx_channel, dma::Data_Type::MEMORY_ADDRESS, true);
+        dma_->set_transfer_count(tx_channel, static_cast<uint32_t>(response_.size()));
+    }
+    dma_->set_channel_enable(tx_channel, true);
+    spi_.set_dma_enable(DMA_Direction::DMA_TX, true);
+    write_register(spi_, SPI_Regs::CTL0, ctl0 | bit_mask(CTL0_Bits::SPIEN));
+}
+
+void Slave_Transport::handle_nss_interrupt() {
+    if (!EXTI_DEVICE.get_interrupt_flag(line_)) {
+        return;
+    }
+    EXTI_DEVICE.clear_interrupt_flag(line_);
+    if (dma_ == nullptr) {
+        return;
+    }
+
+    // Halves the DMA interrupt has not seen yet
+    count_halves();
+    const size_t size = ring_.size();
+    const size_t half = size / 2;
+    const size_t end = ring_position();
+    const size_t residual = (end + size - frame_start_) % size;
+    // Halves passed within the residual alone, every full lap adds two more
+    const uint32_t residual_halves = static_cast<uint32_t>(((frame_start_ + residual) / half) - (frame_start_ / half));
+    const uint32_t halves = halves_;
+    halves_ = 0;
+    // A glitch on NSS without clocks leaves the armed response in place
+    if ((residual == 0) && (halves == 0) && !response_pending_) {
+        return;
+    }
+
+    const bool lapped = halves > residual_halves;
+    const size_t length = lapped ? residual + (((halves - residual_halves + 1) / 2) * size) : residual;
+    if (lapped || ((read_register<uint32_t>(spi_, SPI_Regs::STAT) & bit_mask(STAT_Bits::RXORERR)) != 0)) {
+        overruns_ = overruns_ + 1;
+    }
+    if (!response_.empty() && (length > response_.size())) {
+        underruns_ = underruns_ + 1;
+    }
+    if (response_pending_) {
+        response_ = pending_response_;
+        response_pending_ = false;
+    }
+    rearm();
+
+    // A frame that lapped the ring has been overwritten by its own tail
+    if ((length == 0) || lapped) {
+        frame_start_ = end;
+        return;
+    }
+    const std::span<const uint8_t> first = std::span<const uint8_t>(ring_).subspan(frame_start_, std::min(length, size - frame_start_));
+    const std::span<const uint8_t> second = std::span<const uint8_t>(ring_).first(length - first.size());
+    frame_start_ = end;
+    frames_ = frames_ + 1;
+    if (callback_) {
+        callback_(first, second);
+    }
+}
+
+} // namespace spi
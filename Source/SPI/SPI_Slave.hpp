@@ -0,0 +1,97 @@
+// gd32f30x SPI slave transport in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "AFIO.hpp"
+#include "DMA.hpp"
+#include "EXTI.hpp"
+#include "SPI.hpp"
+
+namespace spi {
+
+//
+// SPI slave that never touches single bytes: RX DMA runs in circular mode
+// over a caller owned ring for as long as the transport is up, and TX DMA
+// is armed with the response buffer before the host selects us. A rising
+// edge on NSS (EXTI on the same pin) ends the transaction; the frame is
+// located in the ring from the DMA counter and handed to the callback.
+//
+// Responses are swapped without copying: set_response() queues a buffer
+// that is armed at the next transaction boundary, until then the current
+// one is sent again. Once a frame callback runs after the swap, the old
+// buffer is no longer read.
+//
+// The byte DMA preloads into DATA is flushed by resetting the SPI between
+// transactions, CTL0/CTL1 are restored. The host must leave the interrupt
+// latency plus a few microseconds between NSS going high and the next
+// select. The ring, of even size, must be longer than the longest
+// transaction: the half and full transfer interrupts count the halves the
+// DMA passes, so a transaction that fills the ring or laps it is detected,
+// dropped and counted as an overrun.
+//
+// The SPI is configured by the caller as a full-duplex 8-bit slave with
+// hardware NSS and enabled. The application forwards the EXTI IRQ handler
+// of the NSS pin to handle_nss_interrupt() and the RX DMA channel interrupt
+// to handle_dma_interrupt(), at the same priority.
+//
+class Slave_Transport {
+public:
+    // The frame may wrap around the ring end, second is then non-empty.
+    // Valid until the ring comes round again.
+    using Frame_Callback = std::function<void(std::span<const uint8_t> first, std::span<const uint8_t> second)>;
+
+    explicit Slave_Transport(SPI& spi) : spi_(spi) {}
+
+    SPI_Error_Type begin(const SPI_Slave_Config& config, std::span<uint8_t> rx_ring,
+                         std::span<const uint8_t> response, Frame_Callback callback);
+    void end();
+
+    // Armed at the next transaction boundary
+    SPI_Error_Type set_response(std::span<const uint8_t> response);
+
+    uint32_t get_frame_count() const {
+        return frames_;
+    }
+    // RXORERR, DMA did not keep up with the host, or a transaction at least
+    // as long as the ring
+    uint32_t get_overrun_count() const {
+        return overruns_;
+    }
+    // The host clocked more bytes than the response held
+    uint32_t get_underrun_count() const {
+        return underruns_;
+    }
+
+    // Call from the EXTI IRQ handler of the NSS pin
+    void handle_nss_interrupt();
+    // Call from the IRQ handler of the RX DMA channel
+    void handle_dma_interrupt();
+
+private:
+    SPI& spi_;
+    dma::DMA* dma_ = nullptr;
+    exti::EXTI_Line line_ = exti::EXTI_Line::EXTI0;
+    std::span<uint8_t> ring_;
+    size_t frame_start_ = 0;
+    // Ring halves completed since frame_start_
+    volatile uint32_t halves_ = 0;
+    std::span<const uint8_t> response_;
+    std::span<const uint8_t> pending_response_;
+    volatile bool response_pending_ = false;
+    Frame_Callback callback_;
+    volatile uint32_t frames_ = 0;
+    volatile uint32_t overruns_ = 0;
+    volatile uint32_t underruns_ = 0;
+
+    size_t ring_position();
+    void count_halves();
+    void rearm();
+};
+
+} // namespace spi
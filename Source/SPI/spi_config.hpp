@@ -8,6 +8,7 @@
 #include <cstdint>
 
 #include "CONFIG.hpp"
+#include "dma_config.hpp"
 
 namespace spi {
 
@@ -213,12 +214,52 @@ enum class Interrupt_Flags {
     INTR_FLAG_FER,
 };
 
+// Lanes used by NOR flash reads: command-address-data
+enum class Flash_Read_Mode {
+    READ_1_1_1,     // 0x0B fast read
+    READ_1_1_4,     // 0x6B quad output fast read
+    READ_1_4_4,     // 0xEB quad I/O fast read
+};
+
+enum class Flash_Erase_Size {
+    SECTOR_4K,
+    BLOCK_32K,
+    BLOCK_64K,
+    CHIP,
+};
+
+// I2SOPMOD values
+enum class I2S_Mode {
+    SLAVE_TX,
+    SLAVE_RX,
+    MASTER_TX,
+    MASTER_RX,
+};
+
+enum class I2S_Standard {
+    PHILIPS,
+    MSB,
+    LSB,
+    PCM_SHORT,
+    PCM_LONG,
+};
+
+// DTLEN values, 24 and 32-bit data take two DATA half-words per sample
+enum class I2S_Data_Length {
+    DATA_16BIT,
+    DATA_24BIT,
+    DATA_32BIT,
+};
+
 enum class SPI_Error_Type {
     OK = 0,
     INVALID_SPI,
     INVALID_OPERATION,
     INITIALIZATION_FAILED,
     INVALID_SELECTION,
+    DMA_TRANSFER_ERROR,
+    TIMEOUT,
+    CRC_ERROR,
 };
 
 
@@ -235,6 +276,18 @@ static const SPI_Clock_Config SPI_pclk_index[] = {
     {rcu::RCU_PCLK::PCLK_SPI2, rcu::RCU_PCLK_Reset::PCLK_SPI2RST},
 };
 
+struct SPI_DMA_Channels {
+    dma::DMA_Base dma_base;
+    dma::DMA_Channel rx_channel;
+    dma::DMA_Channel tx_channel;
+};
+
+static const SPI_DMA_Channels SPI_dma_index[] = {
+    {dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL1, dma::DMA_Channel::CHANNEL2},
+    {dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL3, dma::DMA_Channel::CHANNEL4},
+    {dma::DMA_Base::DMA1_BASE, dma::DMA_Channel::CHANNEL0, dma::DMA_Channel::CHANNEL1},
+};
+
 struct SPI_Pin_Config {
     gpio::GPIO_Base gpio_port;
     gpio::Pin_Number pin;
@@ -260,4 +313,114 @@ struct SPI_Config {
     Clock_Phase clock_phase;
 };
 
+// One device on a shared bus, chip select is a GPIO output
+struct SPI_Device_Config {
+    gpio::GPIO_Base cs_port;
+    gpio::Pin_Number cs_pin;
+    bool cs_active_high;
+    PCLK_Divider pclk_divider;
+    Frame_Format frame_format;
+    Endian_Type msbf;
+    Clock_Polarity polarity_pull;
+    Clock_Phase clock_phase;
+};
+
+// JEDEC 0x9F response, capacity is the log2 of the size in bytes on most parts
+struct Flash_JEDEC_ID {
+    uint8_t manufacturer;
+    uint8_t memory_type;
+    uint8_t capacity;
+};
+
+// SPI0 quad mode flash. The SPI itself is configured by the caller as an
+// 8-bit full-duplex master; IO2/IO3 are the extra quad data lines.
+struct NOR_Flash_Config {
+    gpio::GPIO_Base cs_port;
+    gpio::Pin_Number cs_pin;
+    SPI_Pin_Config io2_pin;
+    SPI_Pin_Config io3_pin;
+    Flash_Read_Mode read_mode;
+    bool quad_program;
+};
+
+// I2S on SPI1/SPI2. clock_frequency is the I2S clock, 0 takes CK_SYS; on
+// connectivity line parts with I2SxSEL set pass the PLL2 x2 frequency.
+struct I2S_Config {
+    I2S_Mode mode;
+    I2S_Standard standard;
+    I2S_Data_Length data_length;
+    bool channel_32bit;         // Forced for 24 and 32-bit data
+    Clock_Polarity idle_polarity;
+    uint32_t sample_rate;
+    bool mclk_output;
+    uint32_t clock_frequency;
+    uint32_t tolerance_ppm;     // 0 accepts any reachable rate
+};
+
+struct I2S_Clock_Result {
+    uint32_t divider;   // I2SPSC DIV
+    bool odd;           // I2SPSC OF
+    uint32_t achieved;  // Actual sample rate
+    int32_t error_ppm;
+    bool valid;         // DIV within 2..255
+};
+
+// Slave transport, NSS is also routed to EXTI to see the end of a transaction
+struct SPI_Slave_Config {
+    gpio::GPIO_Base nss_port;
+    gpio::Pin_Number nss_pin;
+};
+
+// Master CTL0 value for a device, software NSS held high and SPIEN set
+constexpr uint32_t device_ctl0_image(const SPI_Device_Config& config) {
+    uint32_t image = (1U << (static_cast<uint32_t>(CTL0_Bits::MSTMOD) >> 16)) |
+                     (1U << (static_cast<uint32_t>(CTL0_Bits::SPIEN) >> 16)) |
+                     (1U << (static_cast<uint32_t>(CTL0_Bits::SWNSS) >> 16)) |
+                     (1U << (static_cast<uint32_t>(CTL0_Bits::SWNSSEN) >> 16)) |
+                     (static_cast<uint32_t>(config.pclk_divider) << (static_cast<uint32_t>(CTL0_Bits::PSC) >> 16));
+    if (config.polarity_pull == Clock_Polarity::PULL_HIGH) {
+        image |= 1U << (static_cast<uint32_t>(CTL0_Bits::CKPL) >> 16);
+    }
+    if (config.clock_phase == Clock_Phase::PHASE_SECOND_EDGE) {
+        image |= 1U << (static_cast<uint32_t>(CTL0_Bits::CKPH) >> 16);
+    }
+    if (config.msbf == Endian_Type::LSBF) {
+        image |= 1U << (static_cast<uint32_t>(CTL0_Bits::LF) >> 16);
+    }
+    if (config.frame_format == Frame_Format::FF_16BIT) {
+        image |= 1U << (static_cast<uint32_t>(CTL0_Bits::FF16) >> 16);
+    }
+    return image;
+}
+
+///////////////////////////// I2S CLOCK /////////////////////////////
+
+// Fs = I2SCLK / (frame * (2 * DIV + OF)), where a frame is 256 clocks with
+// MCK output, otherwise two channels of 16 or 32 bits
+constexpr uint32_t MinimumI2SDivider = 2;
+constexpr uint32_t MaximumI2SDivider = 0xFF;
+
+constexpr I2S_Clock_Result calculate_i2s_clock(uint32_t i2s_clock, uint32_t sample_rate, bool channel_32bit, bool mclk_output) {
+    if ((i2s_clock == 0) || (sample_rate == 0)) {
+        return I2S_Clock_Result{0, false, 0, 0, false};
+    }
+    const uint64_t frame = mclk_output ? 256 : (channel_32bit ? 64 : 32);
+    const uint32_t scaled = static_cast<uint32_t>((static_cast<uint64_t>(i2s_clock) + (frame * sample_rate) / 2) / (frame * sample_rate));
+    const uint32_t divider = scaled / 2;
+    const bool odd = (scaled & 1U) != 0;
+    if ((divider < MinimumI2SDivider) || (divider > MaximumI2SDivider)) {
+        return I2S_Clock_Result{divider, odd, 0, 0, false};
+    }
+    const uint32_t achieved = static_cast<uint32_t>(i2s_clock / (frame * scaled));
+    // From the exact divider, achieved is truncated to whole samples per second
+    const int64_t ideal = static_cast<int64_t>(sample_rate * frame * scaled);
+    const int64_t error_ppm = ((static_cast<int64_t>(i2s_clock) - ideal) * 1000000) / ideal;
+    return I2S_Clock_Result{divider, odd, achieved, static_cast<int32_t>(error_ppm), true};
+}
+
+static_assert(calculate_i2s_clock(120000000, 48000, true, false).divider == 19);
+static_assert(calculate_i2s_clock(120000000, 48000, true, false).odd);
+static_assert(!calculate_i2s_clock(8000000, 192000, true, false).valid);
+static_assert(calculate_i2s_clock(120000000, 48000, true, false).error_ppm == 1602);
+
 } // namespace spi
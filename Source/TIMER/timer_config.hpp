@@ -9,6 +9,7 @@
 
 #include "GPIO.hpp"
 #include "CONFIG.hpp"
+#include "dma_config.hpp"
 
 namespace timer {
 
@@ -576,6 +577,23 @@ static const TIMER_Clock_Config TIMER_pclk_index[] {
     {rcu::RCU_PCLK::PCLK_TIMER7, rcu::RCU_PCLK_Reset::PCLK_TIMER7RST},
 };
 
+// DMA channel serving the update (UPDEN) request of each timer
+struct TIMER_DMA_Channel {
+    dma::DMA_Base dma_base;
+    dma::DMA_Channel channel;
+};
+
+static const TIMER_DMA_Channel TIMER_update_dma_index[] {
+    {dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL4},
+    {dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL1},
+    {dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL2},
+    {dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL6},
+    {dma::DMA_Base::DMA1_BASE, dma::DMA_Channel::CHANNEL1},
+    {dma::DMA_Base::DMA1_BASE, dma::DMA_Channel::CHANNEL2},
+    {dma::DMA_Base::DMA1_BASE, dma::DMA_Channel::CHANNEL3},
+    {dma::DMA_Base::DMA1_BASE, dma::DMA_Channel::CHANNEL0},
+};
+
 struct TIMER_Pin_Config {
     gpio::GPIO_Base gpio_port;
     gpio::Pin_Number pin;
@@ -2,6 +2,7 @@
 // Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
 // All rights reserved.
 
+#include "CORTEX.hpp"
 #include "USART.hpp"
 
 // Initialize the static member
@@ -23,18 +24,26 @@ namespace usart {
 // function calling overhead. This is in constrast to calling 5+ different functions for
 // the same task.
 //
-void USART::init() {
+USART_Error_Type USART::init() {
     // Some bits cannot be written unless USART is disabled
     write_bit(*this, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::UEN), Clear);
 
+    // Refuse a rate the dividers cannot hit closely enough, the USART stays disabled
+    baud_result_ = calculate_baud(get_pclk_frequency(), config_.baudrate);
+    if (!baud_within_tolerance(baud_result_, config_.baud_tolerance_ppm)) {
+        return USART_Error_Type::BAUD_OUT_OF_TOLERANCE;
+    }
+
     // Set USART configuration parameters
     write_bits(*this, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::WL), static_cast<uint32_t>(config_.word_length),
                static_cast<uint32_t>(CTL0_Bits::PMEN), static_cast<uint32_t>(config_.parity));
     write_bit(*this, USART_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::STB), static_cast<uint32_t>(config_.stop_bits));
     write_bit(*this, USART_Regs::CTL3, static_cast<uint32_t>(CTL3_Bits::MSBF), static_cast<uint32_t>(config_.msbf));
     set_direction(config_.direction);
-    set_baudrate(config_.baudrate);
+    write_register<uint32_t>(*this, USART_Regs::BAUD, baud_result_.divider);
     write_bit(*this, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::UEN), Set);
+
+    return USART_Error_Type::OK;
 }
 
 void USART::release() {
@@ -91,25 +100,22 @@ void USART::pin_config_init() {
 }
 
 void inline USART::set_baudrate(uint32_t baudrate) {
-    uint32_t freq = 0;
+    const Baud_Result result = calculate_baud(get_pclk_frequency(), baudrate);
 
-    // Must not be zero
-    if (baudrate == 0) {
+    // Out of range dividers would be truncated by the register
+    if (!result.valid) {
         return;
     }
+    baud_result_ = result;
+    write_register<uint32_t>(*this, USART_Regs::BAUD, result.divider);
+}
 
-    // Get clock frequency based on the USART instance
+uint32_t USART::get_pclk_frequency() const {
+    // USART0 is on APB2, the others on APB1
     if (base_index_ == USART_Base::USART0_BASE) {
-        freq = RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_APB2);
-    } else {
-        freq = RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_APB1);
+        return RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_APB2);
     }
-
-    // Calculate the USARTDIV value
-    uint32_t usart_div = (freq + (baudrate / 2)) / baudrate;
-
-    // Write to the baud rate register
-    write_register<uint32_t>(*this, USART_Regs::BAUD, usart_div);
+    return RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_APB1);
 }
 
 void USART::set_parity(Parity_Mode parity) {
@@ -276,6 +282,75 @@ void USART::set_hwfc_cts_enable(bool enable) {
     write_bit(*this, USART_Regs::CTL2, static_cast<uint32_t>(CTL2_Bits::CTSEN), enable ? Set : Clear);
 }
 
+void USART::rs485_configure(RS485_Config config) {
+    auto gpio_result = gpio::GPIO::get_instance(config.de_port);
+    if (gpio_result.error() != gpio::GPIO_Error_Type::OK) {
+        return;
+    }
+    gpio::GPIO& de_port = gpio_result.value();
+
+    rs485_config_ = config;
+    de_mask_ = 1U << static_cast<uint32_t>(config.de_pin);
+    de_assert_reg_ = de_port.reg_address(config.de_active_high ? gpio::GPIO_Regs::BOP : gpio::GPIO_Regs::BC);
+    de_release_reg_ = de_port.reg_address(config.de_active_high ? gpio::GPIO_Regs::BC : gpio::GPIO_Regs::BOP);
+
+    // Driver off before the pin becomes an output
+    *de_release_reg_ = de_mask_;
+    de_asserted_ = false;
+    de_port.init_pin(config.de_pin, gpio::Pin_Mode::OUTPUT_PUSHPULL, gpio::Output_Speed::SPEED_50MHZ);
+}
+
+//
+// The character time is taken from the stored configuration, so the mode
+// must be (re)enabled after a baudrate or frame format change. Turnaround
+// statistics need the DWT cycle counter to be running.
+//
+void USART::set_rs485_mode_enable(bool enable) {
+    if (enable && (de_assert_reg_ == nullptr)) {
+        return;
+    }
+    if (!enable && de_asserted_) {
+        *de_release_reg_ = de_mask_;
+        de_asserted_ = false;
+    }
+
+    if (enable && (config_.baudrate != 0)) {
+        uint32_t bits = (config_.word_length == Word_Length::WL_9BITS) ? 10 : 9;
+        bits += ((config_.stop_bits == Stop_Bits::STB_2BIT) || (config_.stop_bits == Stop_Bits::STB_1_5BIT)) ? 2 : 1;
+        // Deadline counts DWT cycles, which run at HCLK
+        const uint64_t clock = RCU_DEVICE.get_clock_frequency(rcu::Clock_Frequency::CK_AHB);
+        character_cycles_ = static_cast<uint32_t>((clock * bits) / config_.baudrate);
+    }
+    set_half_duplex_enable(enable && rs485_config_.half_duplex);
+    rs485_enabled_ = enable;
+}
+
+//
+// Called when TBE reports the last byte moved into the shifter, TC follows
+// one character later. With DMA the last byte may still wait in DATA, which
+// makes the measured turnaround an upper bound.
+//
+void USART::rs485_arm_release() {
+    if (rs485_enabled_) {
+        rs485_arm_cycle_ = CORTEX_DEVICE.get_cycle_count();
+    }
+}
+
+void USART::rs485_driver_release() {
+    if (!rs485_enabled_ || !de_asserted_) {
+        return;
+    }
+    *de_release_reg_ = de_mask_;
+    de_asserted_ = false;
+
+    const uint32_t elapsed = CORTEX_DEVICE.get_cycle_count() - rs485_arm_cycle_;
+    const uint32_t turnaround = (elapsed > character_cycles_) ? elapsed - character_cycles_ : 0;
+    rs485_stats_.last_turnaround_cycles = turnaround;
+    if (turnaround > rs485_stats_.max_turnaround_cycles) {
+        rs485_stats_.max_turnaround_cycles = turnaround;
+    }
+}
+
 bool USART::get_flag(Status_Flags flag) {
     uint32_t value = 0;
 
@@ -436,6 +511,107 @@ bool USART::get_interrupt_flag(Interrupt_Flags flag) {
     return ((intr_flag != 0) && (state != 0));
 }
 
+//
+// Six register reads instead of two per flag queried. STAT1 and CTL3 only
+// exist on USART0-2.
+//
+USART_Status_Snapshot USART::status_snapshot() {
+    USART_Status_Snapshot snapshot = {};
+    const bool extended = (base_index_ != USART_Base::UART3_BASE) && (base_index_ != USART_Base::UART4_BASE);
+
+    const uint32_t stat0 = read_register<uint32_t>(*this, USART_Regs::STAT0);
+    const uint32_t stat1 = extended ? read_register<uint32_t>(*this, USART_Regs::STAT1) : 0;
+    const uint32_t ctl0 = read_register<uint32_t>(*this, USART_Regs::CTL0);
+    const uint32_t ctl1 = read_register<uint32_t>(*this, USART_Regs::CTL1);
+    const uint32_t ctl2 = read_register<uint32_t>(*this, USART_Regs::CTL2);
+    const uint32_t ctl3 = extended ? read_register<uint32_t>(*this, USART_Regs::CTL3) : 0;
+
+    auto event = [&snapshot](Interrupt_Flags flag, bool active) {
+        if (active) {
+            snapshot.events |= 1U << static_cast<uint32_t>(flag);
+        }
+    };
+    const bool errie = (ctl2 & bit_mask(CTL2_Bits::ERRIE)) != 0;
+    const bool rbneie = (ctl0 & bit_mask(CTL0_Bits::RBNEIE)) != 0;
+
+    event(Interrupt_Flags::INTR_FLAG_CTL0_PERR, (stat0 & bit_mask(STAT0_Bits::PERR)) && (ctl0 & bit_mask(CTL0_Bits::PERRIE)));
+    event(Interrupt_Flags::INTR_FLAG_CTL0_TBE, (stat0 & bit_mask(STAT0_Bits::TBE)) && (ctl0 & bit_mask(CTL0_Bits::TBEIE)));
+    event(Interrupt_Flags::INTR_FLAG_CTL0_TC, (stat0 & bit_mask(STAT0_Bits::TC)) && (ctl0 & bit_mask(CTL0_Bits::TCIE)));
+    event(Interrupt_Flags::INTR_FLAG_CTL0_RBNE, (stat0 & bit_mask(STAT0_Bits::RBNE)) && rbneie);
+    event(Interrupt_Flags::INTR_FLAG_CTL0_ORERR, (stat0 & bit_mask(STAT0_Bits::ORERR)) && rbneie);
+    event(Interrupt_Flags::INTR_FLAG_CTL0_IDLEF, (stat0 & bit_mask(STAT0_Bits::IDLEF)) && (ctl0 & bit_mask(CTL0_Bits::IDLEIE)));
+    event(Interrupt_Flags::INTR_FLAG_CTL1_LBDF, (stat0 & bit_mask(STAT0_Bits::LBDF)) && (ctl1 & bit_mask(CTL1_Bits::LBDIE)));
+    event(Interrupt_Flags::INTR_FLAG_CTL2_CTSF, (stat0 & bit_mask(STAT0_Bits::CTSF)) && (ctl2 & bit_mask(CTL2_Bits::CTSIE)));
+    event(Interrupt_Flags::INTR_FLAG_CTL2_ORERR, (stat0 & bit_mask(STAT0_Bits::ORERR)) && errie);
+    event(Interrupt_Flags::INTR_FLAG_CTL2_NERR, (stat0 & bit_mask(STAT0_Bits::NERR)) && errie);
+    event(Interrupt_Flags::INTR_FLAG_CTL2_FERR, (stat0 & bit_mask(STAT0_Bits::FERR)) && errie);
+    event(Interrupt_Flags::INTR_FLAG_CTL3_EBF, (stat1 & bit_mask(STAT1_Bits::EBF)) && (ctl3 & bit_mask(CTL3_Bits::EBIE)));
+    event(Interrupt_Flags::INTR_FLAG_CTL3_RTF, (stat1 & bit_mask(STAT1_Bits::RTF)) && (ctl3 & bit_mask(CTL3_Bits::RTIE)));
+
+    snapshot.stat0 = stat0;
+    snapshot.stat1 = stat1;
+    return snapshot;
+}
+
+//
+// PERR, FERR, NERR, ORERR, IDLEF and RBNE clear by the STAT0 read already
+// done for the snapshot followed by one DATA read, whose value is kept in
+// the snapshot. RBNE alone only triggers that read when its interrupt is
+// enabled. With DENR set the received bytes belong to the DMA: DATA is only
+// read while RBNE is clear, otherwise the DMA's own read of the waiting byte
+// completes the sequence, as in DMA_Receiver.
+//
+// TC, LBDF, CTSF, RTF and EBF clear by writing 0 and ignore writing 1, so
+// one store of the other writable bits set leaves flags raised since the
+// snapshot untouched, which a read-modify-write would not.
+//
+void USART::acknowledge(USART_Status_Snapshot& snapshot) {
+    constexpr uint32_t ClearedByDataRead = bit_mask(STAT0_Bits::PERR) | bit_mask(STAT0_Bits::FERR) |
+                                           bit_mask(STAT0_Bits::NERR) | bit_mask(STAT0_Bits::ORERR) |
+                                           bit_mask(STAT0_Bits::IDLEF);
+    constexpr uint32_t Stat0ClearableBits = bit_mask(STAT0_Bits::RBNE) | bit_mask(STAT0_Bits::TC) |
+                                            bit_mask(STAT0_Bits::LBDF) | bit_mask(STAT0_Bits::CTSF);
+    constexpr uint32_t Stat1ClearableBits = bit_mask(STAT1_Bits::RTF) | bit_mask(STAT1_Bits::EBF);
+
+    snapshot.data_read = false;
+    bool read_data;
+    if ((read_register<uint32_t>(*this, USART_Regs::CTL2) & bit_mask(CTL2_Bits::DENR)) != 0) {
+        read_data = ((snapshot.stat0 & ClearedByDataRead) != 0) &&
+                    ((read_register<uint32_t>(*this, USART_Regs::STAT0) & bit_mask(STAT0_Bits::RBNE)) == 0);
+    } else {
+        read_data = ((snapshot.stat0 & ClearedByDataRead) != 0) || snapshot.test(Interrupt_Flags::INTR_FLAG_CTL0_RBNE);
+    }
+    if (read_data) {
+        snapshot.data = receive_data();
+        snapshot.data_read = true;
+    }
+
+    uint32_t stat0_clear = 0;
+    if (snapshot.test(Interrupt_Flags::INTR_FLAG_CTL0_TC)) {
+        stat0_clear |= bit_mask(STAT0_Bits::TC);
+    }
+    if (snapshot.test(Interrupt_Flags::INTR_FLAG_CTL1_LBDF)) {
+        stat0_clear |= bit_mask(STAT0_Bits::LBDF);
+    }
+    if (snapshot.test(Interrupt_Flags::INTR_FLAG_CTL2_CTSF)) {
+        stat0_clear |= bit_mask(STAT0_Bits::CTSF);
+    }
+    if (stat0_clear != 0) {
+        write_register<uint32_t>(*this, USART_Regs::STAT0, Stat0ClearableBits & ~stat0_clear);
+    }
+
+    uint32_t stat1_clear = 0;
+    if (snapshot.test(Interrupt_Flags::INTR_FLAG_CTL3_RTF)) {
+        stat1_clear |= bit_mask(STAT1_Bits::RTF);
+    }
+    if (snapshot.test(Interrupt_Flags::INTR_FLAG_CTL3_EBF)) {
+        stat1_clear |= bit_mask(STAT1_Bits::EBF);
+    }
+    if (stat1_clear != 0) {
+        write_register<uint32_t>(*this, USART_Regs::STAT1, Stat1ClearableBits & ~stat1_clear);
+    }
+}
+
 void USART::clear_interrupt_flag(Interrupt_Flags flag) {
     switch (flag) {
     case Interrupt_Flags::INTR_FLAG_CTL0_PERR:
@@ -43,15 +43,15 @@ public:
         }
     }
 
-    void init();
+    USART_Error_Type init();
     void reset() {
         RCU_DEVICE.set_pclk_reset_enable(USART_pclk_info_.reset_reg, true);
         RCU_DEVICE.set_pclk_reset_enable(USART_pclk_info_.reset_reg, false);
     }
     void release();
-    void configure(USART_Config new_config) {
+    USART_Error_Type configure(USART_Config new_config) {
         config_ = new_config;
-        init();
+        return init();
     }
     void pin_config_init();
     void pins_configure(USART_Pins pin_config) {
@@ -59,6 +59,11 @@ public:
         pin_config_init();
     }
     inline void set_baudrate(uint32_t baudrate);
+    // Divider and error of the last set_baudrate()/init()
+    Baud_Result get_baud_result() const {
+        return baud_result_;
+    }
+    uint32_t get_pclk_frequency() const;
     void set_parity(Parity_Mode parity);
     void set_word_length(Word_Length word_length);
     void set_stop_bits(Stop_Bits stop_bits);
@@ -96,12 +101,51 @@ public:
     // HWFC
     void set_hwfc_rts_enable(bool enable);
     void set_hwfc_cts_enable(bool enable);
+    // RS-485
+    void rs485_configure(RS485_Config config);
+    void set_rs485_mode_enable(bool enable);
+    bool is_rs485_enabled() const {
+        return rs485_enabled_;
+    }
+    // Raise DE before the first byte of a burst
+    inline void rs485_driver_enable() {
+        if (rs485_enabled_ && !de_asserted_) {
+            *de_assert_reg_ = de_mask_;
+            de_asserted_ = true;
+            rs485_stats_.transmissions = rs485_stats_.transmissions + 1;
+        }
+    }
+    // Last byte handed to the transmitter, the TC interrupt ends the burst
+    void rs485_arm_release();
+    // Drop DE, called from the TC interrupt
+    void rs485_driver_release();
+    RS485_Statistics get_rs485_statistics() const {
+        return rs485_stats_;
+    }
+    void clear_rs485_statistics() {
+        rs485_stats_ = {};
+    }
     // Interrupt and flags
     bool get_flag(Status_Flags flag);
     void clear_flag(Status_Flags flag);
     bool get_interrupt_flag(Interrupt_Flags flag);
     void clear_interrupt_flag(Interrupt_Flags flag);
     void set_interrupt_enable(Interrupt_Type type, bool enable);
+    // STAT0, STAT1 and the enable bits read once and decoded
+    USART_Status_Snapshot status_snapshot();
+    // Clear what the snapshot reported, reading DATA at most once
+    void acknowledge(USART_Status_Snapshot& snapshot);
+    // Acknowledge, then call handler(Interrupt_Flags, const USART_Status_Snapshot&) per event
+    template <typename Handler>
+    void dispatch(USART_Status_Snapshot snapshot, Handler&& handler) {
+        acknowledge(snapshot);
+        uint32_t events = snapshot.events;
+        while (events != 0) {
+            const uint32_t index = static_cast<uint32_t>(__builtin_ctz(events));
+            events &= events - 1;
+            handler(static_cast<Interrupt_Flags>(index), snapshot);
+        }
+    }
 
     inline volatile uint32_t *reg_address(USART_Regs reg) const {
         return reinterpret_cast<volatile uint32_t *>(base_address_ + static_cast<uint32_t>(reg));
@@ -130,6 +174,18 @@ private:
 
     USART_Config config_;
     USART_Pins pin_config_;
+    Baud_Result baud_result_ = {};
+
+    // RS-485 driver enable, written with single BOP/BC stores
+    RS485_Config rs485_config_ = {};
+    volatile uint32_t *de_assert_reg_ = nullptr;
+    volatile uint32_t *de_release_reg_ = nullptr;
+    uint32_t de_mask_ = 0;
+    volatile bool de_asserted_ = false;
+    bool rs485_enabled_ = false;
+    uint32_t character_cycles_ = 0;
+    uint32_t rs485_arm_cycle_ = 0;
+    RS485_Statistics rs485_stats_ = {};
 
     template <USART_Base Base>
     static USART& get_instance_for_base() {
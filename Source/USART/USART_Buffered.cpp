@@ -0,0 +1,186 @@
+// gd32f30x USART interrupt driven buffered driver in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <algorithm>
+
+#include "USART_Buffered.hpp"
+
+namespace usart {
+
+constexpr uint32_t ReceiveErrorMask = bit_mask(STAT0_Bits::PERR) | bit_mask(STAT0_Bits::FERR) |
+                                      bit_mask(STAT0_Bits::NERR) | bit_mask(STAT0_Bits::ORERR);
+
+USART_Error_Type Buffered_USART::begin(std::span<uint8_t> tx_storage, std::span<uint8_t> rx_storage) {
+    if (!tx_ring_.attach(tx_storage) || !rx_ring_.attach(rx_storage)) {
+        return USART_Error_Type::INITIALIZATION_FAILED;
+    }
+    tx_active_ = false;
+    clear_error_counters();
+
+    // Drop anything left over in the data register
+    read_register<uint32_t>(usart_, USART_Regs::STAT0);
+    read_register<uint32_t>(usart_, USART_Regs::DATA);
+
+    write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TBEIE), Clear,
+               static_cast<uint32_t>(CTL0_Bits::TCIE), Clear,
+               static_cast<uint32_t>(CTL0_Bits::RBNEIE), Set,
+               static_cast<uint32_t>(CTL0_Bits::PERRIE), Set);
+    NVIC_EnableIRQ(USART_irqNumber[static_cast<int>(usart_.base_index_)]);
+
+    return USART_Error_Type::OK;
+}
+
+void Buffered_USART::end() {
+    NVIC_DisableIRQ(USART_irqNumber[static_cast<int>(usart_.base_index_)]);
+    write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TBEIE), Clear,
+               static_cast<uint32_t>(CTL0_Bits::TCIE), Clear,
+               static_cast<uint32_t>(CTL0_Bits::RBNEIE), Clear,
+               static_cast<uint32_t>(CTL0_Bits::PERRIE), Clear);
+    tx_active_ = false;
+}
+
+size_t Buffered_USART::write(std::span<const uint8_t> data) {
+    const size_t accepted = tx_ring_.write(data);
+    if (accepted != 0) {
+        start_transmit();
+    }
+    return accepted;
+}
+
+size_t Buffered_USART::read(std::span<uint8_t> data) {
+    // Plain reads invalidate a partial line scan
+    line_scan_offset_ = 0;
+    return rx_ring_.read(data);
+}
+
+//
+// Bytes already searched are remembered in line_scan_offset_, so polling for
+// a line while it trickles in scans each byte only once.
+//
+size_t Buffered_USART::read_line(std::span<uint8_t> line, uint8_t delimiter) {
+    size_t length;
+
+    if (find_byte(rx_ring_, delimiter, line_scan_offset_)) {
+        length = line_scan_offset_ + 1;
+    } else if (rx_ring_.full()) {
+        length = rx_ring_.capacity();
+    } else {
+        return 0;
+    }
+    line_scan_offset_ = 0;
+
+    const size_t copied = rx_ring_.read(line.first(std::min(length, line.size())));
+    rx_ring_.consume(length - copied);
+    return copied;
+}
+
+size_t Buffered_USART::write_blocking(std::span<const uint8_t> data, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+    size_t written = 0;
+
+    while (written < data.size()) {
+        written += write(data.subspan(written));
+        if ((written < data.size()) && deadline.expired()) {
+            break;
+        }
+    }
+    return written;
+}
+
+size_t Buffered_USART::read_blocking(std::span<uint8_t> data, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+    size_t received = 0;
+
+    while (received < data.size()) {
+        received += read(data.subspan(received));
+        if ((received < data.size()) && deadline.expired()) {
+            break;
+        }
+    }
+    return received;
+}
+
+USART_Error_Type Buffered_USART::flush(uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    while (tx_active_) {
+        if (deadline.expired()) {
+            return USART_Error_Type::TIMEOUT;
+        }
+    }
+    return USART_Error_Type::OK;
+}
+
+USART_Error_Counters Buffered_USART::get_error_counters() const {
+    cortex::Critical_Section section;
+    return counters_;
+}
+
+void Buffered_USART::clear_error_counters() {
+    cortex::Critical_Section section;
+    counters_ = {};
+}
+
+//
+// One STAT0 and one CTL0 read per interrupt. Reading STAT0 followed by DATA
+// is also the sequence that clears PERR, FERR, NERR and ORERR, so receive
+// errors are accounted for and cleared on the same pass. Bytes received
+// with a framing or parity error are discarded.
+//
+void Buffered_USART::handle_interrupt() {
+    const uint32_t stat = read_register<uint32_t>(usart_, USART_Regs::STAT0);
+    const uint32_t ctl0 = read_register<uint32_t>(usart_, USART_Regs::CTL0);
+
+    if ((stat & (bit_mask(STAT0_Bits::RBNE) | ReceiveErrorMask)) != 0) {
+        const uint8_t data = static_cast<uint8_t>(usart_.receive_data());
+
+        if ((stat & ReceiveErrorMask) != 0) {
+            if (stat & bit_mask(STAT0_Bits::ORERR)) {
+                counters_.overrun = counters_.overrun + 1;
+            }
+            if (stat & bit_mask(STAT0_Bits::FERR)) {
+                counters_.framing = counters_.framing + 1;
+            }
+            if (stat & bit_mask(STAT0_Bits::NERR)) {
+                counters_.noise = counters_.noise + 1;
+            }
+            if (stat & bit_mask(STAT0_Bits::PERR)) {
+                counters_.parity = counters_.parity + 1;
+            }
+        }
+
+        const bool corrupt = (stat & (bit_mask(STAT0_Bits::FERR) | bit_mask(STAT0_Bits::PERR))) != 0;
+        if (!corrupt && !rx_ring_.push(data)) {
+            counters_.rx_dropped = counters_.rx_dropped + 1;
+        }
+    }
+
+    if ((ctl0 & bit_mask(CTL0_Bits::TBEIE)) && (stat & bit_mask(STAT0_Bits::TBE))) {
+        uint8_t data;
+        if (tx_ring_.pop(data)) {
+            usart_.send_data(data);
+        } else {
+            // Ring drained, wait for the final stop bit
+            usart_.rs485_arm_release();
+            write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TBEIE), Clear,
+                       static_cast<uint32_t>(CTL0_Bits::TCIE), Set);
+        }
+    } else if ((ctl0 & bit_mask(CTL0_Bits::TCIE)) && (stat & bit_mask(STAT0_Bits::TC))) {
+        usart_.rs485_driver_release();
+        write_bit(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TCIE), Clear);
+        write_bit(usart_, USART_Regs::STAT0, static_cast<uint32_t>(STAT0_Bits::TC), Clear);
+        tx_active_ = false;
+    }
+}
+
+// CTL0 is also modified from the ISR, so the read-modify-write is masked
+void Buffered_USART::start_transmit() {
+    cortex::Critical_Section section;
+    tx_active_ = true;
+    usart_.rs485_driver_enable();
+    write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TCIE), Clear,
+               static_cast<uint32_t>(CTL0_Bits::TBEIE), Set);
+}
+
+} // namespace usart
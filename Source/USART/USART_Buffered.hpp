@@ -0,0 +1,82 @@
+// gd32f30x USART interrupt driven buffered driver in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "RingBuffer.hpp"
+#include "ByteScan.hpp"
+#include "CORTEX.hpp"
+#include "USART.hpp"
+
+namespace usart {
+
+//
+// Interrupt driven USART with caller supplied SPSC ring buffers.
+// TX is drained from the TBE interrupt and TC marks the end of a burst,
+// RX is filled from the RBNE interrupt. Only 8-bit words are supported.
+// With RS-485 mode enabled on the USART, DE is raised when a burst starts
+// and dropped from the TC interrupt.
+//
+// The USART must already be configured with USART::configure(). The
+// application forwards its USARTx_IRQHandler to handle_interrupt().
+// Blocking variants take their timeout in core clock cycles, see
+// cortex::Deadline.
+//
+class Buffered_USART {
+public:
+    explicit Buffered_USART(USART& usart) : usart_(usart) {}
+
+    // Ring storage sizes must be powers of two
+    USART_Error_Type begin(std::span<uint8_t> tx_storage, std::span<uint8_t> rx_storage);
+    void end();
+
+    // Non-blocking, return the number of bytes accepted or copied
+    size_t write(std::span<const uint8_t> data);
+    size_t read(std::span<uint8_t> data);
+    // Blocking until done or the deadline expires, return bytes transferred
+    size_t write_blocking(std::span<const uint8_t> data, uint32_t timeout_cycles = cortex::Deadline::Infinite);
+    size_t read_blocking(std::span<uint8_t> data, uint32_t timeout_cycles = cortex::Deadline::Infinite);
+    // Copy one line, delimiter included, and return its length. Returns 0
+    // while no complete line has arrived. A line longer than the buffer is
+    // truncated to fit and its remainder discarded; a full RX ring without a
+    // delimiter is returned as is so reception cannot stall.
+    size_t read_line(std::span<uint8_t> line, uint8_t delimiter = '\n');
+    // Wait until the TX ring is empty and the last stop bit has left the shifter
+    USART_Error_Type flush(uint32_t timeout_cycles = cortex::Deadline::Infinite);
+
+    size_t available() const {
+        return rx_ring_.size();
+    }
+    size_t tx_free() const {
+        return tx_ring_.free_space();
+    }
+    bool is_tx_idle() const {
+        return !tx_active_;
+    }
+
+    USART_Error_Counters get_error_counters() const;
+    void clear_error_counters();
+
+    // Call from the USARTx_IRQHandler
+    void handle_interrupt();
+
+    USART& get_usart() const {
+        return usart_;
+    }
+
+private:
+    USART& usart_;
+    Ring_Buffer<uint8_t> tx_ring_;
+    Ring_Buffer<uint8_t> rx_ring_;
+    volatile bool tx_active_ = false;
+    size_t line_scan_offset_ = 0;
+    USART_Error_Counters counters_ = {};
+
+    void start_transmit();
+};
+
+} // namespace usart
@@ -0,0 +1,180 @@
+// gd32f30x USART circular DMA receiver in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "USART_DMA_Receiver.hpp"
+
+namespace usart {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+
+USART_Error_Type DMA_Receiver::begin(std::span<uint8_t> buffer, Receive_Callback callback, uint32_t rx_timeout_bits) {
+    const USART_DMA_Channels& channels = USART_dma_index[static_cast<int>(usart_.base_index_)];
+    if (!channels.available) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+    if (buffer.empty() || (buffer.size() > MaximumTransferCount)) {
+        return USART_Error_Type::INVALID_SELECTION;
+    }
+
+    auto dma_result = dma::DMA::get_instance(channels.dma_base);
+    if (dma_result.error() != dma::DMA_Error_Type::OK) {
+        return USART_Error_Type::INITIALIZATION_FAILED;
+    }
+    dma_ = &dma_result.value();
+    buffer_ = buffer;
+    callback_ = callback;
+    read_index_ = 0;
+    dma_errors_ = 0;
+
+    const dma::DMA_Channel channel = channels.rx_channel;
+    dma_->reset(channel);
+    dma::DMA_Config rx_config = {
+        .peripheral_address = reinterpret_cast<uint32_t>(usart_.reg_address(USART_Regs::DATA)),
+        .peripheral_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .memory_address = reinterpret_cast<uint32_t>(buffer_.data()),
+        .memory_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .count = static_cast<uint32_t>(buffer_.size()),
+        .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+        .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+        .channel_priority = dma::Channel_Priority::HIGH_PRIORITY,
+        .direction = dma::Transfer_Direction::P2M,
+    };
+    dma_->configure(channel, rx_config);
+    dma_->set_circulation_mode_enable(channel, true);
+    dma_->set_interrupt_enable(channel, dma::Interrupt_Type::INTR_HTFIE, true);
+    dma_->set_interrupt_enable(channel, dma::Interrupt_Type::INTR_FTFIE, true);
+    dma_->set_interrupt_enable(channel, dma::Interrupt_Type::INTR_ERRIE, true);
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channel));
+
+    // Clear a stale IDLEF/RBNE before the first frame
+    read_register<uint32_t>(usart_, USART_Regs::STAT0);
+    read_register<uint32_t>(usart_, USART_Regs::DATA);
+
+    // The receiver timeout is only implemented on USART0-2
+    use_rx_timeout_ = (rx_timeout_bits != 0) &&
+                      (usart_.base_index_ != USART_Base::UART3_BASE) &&
+                      (usart_.base_index_ != USART_Base::UART4_BASE);
+    if (use_rx_timeout_) {
+        usart_.set_rx_timeout_threshold(rx_timeout_bits);
+        usart_.set_rx_timeout_enable(true);
+        usart_.set_interrupt_enable(Interrupt_Type::INTR_RTIE, true);
+    }
+
+    // The receiver timeout supersedes idle detection, one interrupt per frame
+    usart_.set_interrupt_enable(Interrupt_Type::INTR_IDLEIE, !use_rx_timeout_);
+    usart_.set_interrupt_enable(Interrupt_Type::INTR_ERRIE, true);
+    NVIC_EnableIRQ(USART_irqNumber[static_cast<int>(usart_.base_index_)]);
+
+    usart_.receive_data_dma(true);
+    dma_->set_channel_enable(channel, true);
+
+    return USART_Error_Type::OK;
+}
+
+void DMA_Receiver::end() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    usart_.set_interrupt_enable(Interrupt_Type::INTR_IDLEIE, false);
+    usart_.set_interrupt_enable(Interrupt_Type::INTR_ERRIE, false);
+    if (use_rx_timeout_) {
+        usart_.set_interrupt_enable(Interrupt_Type::INTR_RTIE, false);
+        usart_.set_rx_timeout_enable(false);
+    }
+    usart_.receive_data_dma(false);
+    dma_->set_channel_enable(get_dma_channel(), false);
+    dma_->clear_flags(dma::channel_all_flags_mask(get_dma_channel()));
+    dma_ = nullptr;
+}
+
+//
+// STAT0 is read once. IDLEF and the DMA-mode error flags are cleared by
+// that read followed by a DATA read; with DMA owning RBNE the data register
+// holds nothing new when the line is idle.
+//
+void DMA_Receiver::handle_usart_interrupt() {
+    const uint32_t stat0 = read_register<uint32_t>(usart_, USART_Regs::STAT0);
+    constexpr uint32_t ClearedByDataRead = bit_mask(STAT0_Bits::IDLEF) | bit_mask(STAT0_Bits::FERR) |
+                                           bit_mask(STAT0_Bits::NERR) | bit_mask(STAT0_Bits::ORERR);
+
+    if ((stat0 & ClearedByDataRead) != 0) {
+        read_register<uint32_t>(usart_, USART_Regs::DATA);
+    }
+
+    if (use_rx_timeout_) {
+        const uint32_t stat1 = read_register<uint32_t>(usart_, USART_Regs::STAT1);
+        if ((stat1 & bit_mask(STAT1_Bits::RTF)) != 0) {
+            write_bit(usart_, USART_Regs::STAT1, static_cast<uint32_t>(STAT1_Bits::RTF), Clear);
+            report_new_data(Receive_Event::RX_TIMEOUT);
+            return;
+        }
+    }
+
+    if ((stat0 & bit_mask(STAT0_Bits::IDLEF)) != 0) {
+        report_new_data(Receive_Event::IDLE_LINE);
+    }
+}
+
+void DMA_Receiver::handle_dma_interrupt() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    const dma::DMA_Channel channel = get_dma_channel();
+    const dma::DMA_Status_Snapshot status = dma_->get_interrupt_snapshot(1U << static_cast<uint32_t>(channel));
+    dma_->clear_flags(status.flags);
+
+    if (status.test(channel, dma::Status_Flags::FLAG_ERRIF)) {
+        // The channel is disabled by hardware on a transfer error, CNT holds
+        // where it stopped. Restarting with a full count begins at the base.
+        dma_errors_ = dma_errors_ + 1;
+        report_new_data(Receive_Event::DMA_ERROR);
+        dma_->set_channel_enable(channel, false);
+        dma_->clear_flags(dma::channel_all_flags_mask(channel));
+        dma_->set_transfer_count(channel, static_cast<uint32_t>(buffer_.size()));
+        read_index_ = 0;
+        dma_->set_channel_enable(channel, true);
+        return;
+    }
+    if (status.test(channel, dma::Status_Flags::FLAG_FTFIF)) {
+        report_new_data(Receive_Event::FULL_TRANSFER);
+    } else if (status.test(channel, dma::Status_Flags::FLAG_HTFIF)) {
+        report_new_data(Receive_Event::HALF_TRANSFER);
+    }
+}
+
+// Report everything DMA wrote since the last call
+void DMA_Receiver::report_new_data(Receive_Event event) {
+    if (dma_ == nullptr) {
+        return;
+    }
+    const size_t size = buffer_.size();
+    size_t write_index = size - dma_->get_transfer_count(get_dma_channel());
+    if (write_index >= size) {
+        write_index = 0;
+    }
+
+    const size_t read_index = read_index_;
+    read_index_ = write_index;
+    if (!callback_) {
+        return;
+    }
+    if (write_index == read_index) {
+        // Line events still mark a frame boundary when DMA reports got there first
+        if ((event == Receive_Event::IDLE_LINE) || (event == Receive_Event::RX_TIMEOUT) ||
+                (event == Receive_Event::DMA_ERROR)) {
+            callback_(std::span<uint8_t>(), event);
+        }
+        return;
+    }
+    if (write_index > read_index) {
+        callback_(buffer_.subspan(read_index, write_index - read_index), event);
+    } else {
+        callback_(buffer_.subspan(read_index), event);
+        if (write_index != 0) {
+            callback_(buffer_.first(write_index), event);
+        }
+    }
+}
+
+} // namespace usart
@@ -0,0 +1,72 @@
+// gd32f30x USART circular DMA receiver in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "DMA.hpp"
+#include "USART.hpp"
+
+namespace usart {
+
+//
+// Continuous reception of frames with unknown length. DMA fills a circular
+// buffer without CPU involvement and new data is reported as spans pointing
+// straight into that buffer whenever the line goes idle, the optional
+// receiver timeout expires, or DMA reaches the half or end of the buffer.
+// A region that wraps past the end of the buffer is reported as two spans.
+// Idle and timeout events are always reported, with an empty span if the
+// data was already delivered, so they can be used as frame boundaries.
+// When the receiver timeout is enabled it replaces idle line detection.
+//
+// A DMA transfer error disables the channel in hardware. The receiver
+// reports what arrived before it with DMA_ERROR, always, so a frame in
+// progress can be dropped, and re-arms the channel from the start of the
+// buffer; reception carries on without the application restarting it.
+//
+// The callback runs in interrupt context and must consume the data before
+// DMA comes back around to it. DMA is done with the reported bytes, so they
+// may be modified in place (e.g. decoded by Frame_Decoder). The USART and DMA interrupts must share the
+// same preemption priority so reports are never interleaved.
+//
+class DMA_Receiver {
+public:
+    using Receive_Callback = std::function<void(std::span<uint8_t> data, Receive_Event event)>;
+
+    explicit DMA_Receiver(USART& usart) : usart_(usart) {}
+
+    // Buffer size is limited to 65535 bytes by CHXCNT.
+    // rx_timeout_bits enables the RT receiver timeout (USART0-2 only), 0 disables it.
+    USART_Error_Type begin(std::span<uint8_t> buffer, Receive_Callback callback, uint32_t rx_timeout_bits = 0);
+    void end();
+
+    // Call from the USARTx_IRQHandler
+    void handle_usart_interrupt();
+    // Call from the DMA channel IRQ handler of the RX channel
+    void handle_dma_interrupt();
+
+    // Transfer errors, each followed by a re-arm of the channel
+    uint32_t get_dma_error_count() const {
+        return dma_errors_;
+    }
+    dma::DMA_Channel get_dma_channel() const {
+        return USART_dma_index[static_cast<int>(usart_.base_index_)].rx_channel;
+    }
+
+private:
+    USART& usart_;
+    dma::DMA* dma_ = nullptr;
+    std::span<uint8_t> buffer_;
+    Receive_Callback callback_;
+    size_t read_index_ = 0;
+    volatile uint32_t dma_errors_ = 0;
+    bool use_rx_timeout_ = false;
+
+    void report_new_data(Receive_Event event);
+};
+
+} // namespace usart
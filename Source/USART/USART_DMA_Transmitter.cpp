@@ -0,0 +1,168 @@
+// gd32f30x USART queued DMA transmitter in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "CORTEX.hpp"
+#include "USART_DMA_Transmitter.hpp"
+
+namespace usart {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+
+USART_Error_Type DMA_Transmitter::begin(std::span<Entry> queue_storage, bool wait_for_tc) {
+    const USART_DMA_Channels& channels = USART_dma_index[static_cast<int>(usart_.base_index_)];
+    if (!channels.available) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+    if (!queue_.attach(queue_storage)) {
+        return USART_Error_Type::INITIALIZATION_FAILED;
+    }
+
+    auto dma_result = dma::DMA::get_instance(channels.dma_base);
+    if (dma_result.error() != dma::DMA_Error_Type::OK) {
+        return USART_Error_Type::INITIALIZATION_FAILED;
+    }
+    dma_ = &dma_result.value();
+    // RS-485 needs TC to drop the driver enable
+    wait_for_tc_ = wait_for_tc || usart_.is_rs485_enabled();
+    busy_ = false;
+    dma_errors_ = 0;
+
+    const dma::DMA_Channel channel = channels.tx_channel;
+    dma_->reset(channel);
+    dma::DMA_Config tx_config = {
+        .peripheral_address = reinterpret_cast<uint32_t>(usart_.reg_address(USART_Regs::DATA)),
+        .peripheral_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .memory_address = 0,
+        .memory_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .count = 0,
+        .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+        .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+        .channel_priority = dma::Channel_Priority::MEDIUM_PRIORITY,
+        .direction = dma::Transfer_Direction::M2P,
+    };
+    dma_->configure(channel, tx_config);
+    dma_->set_interrupt_enable(channel, dma::Interrupt_Type::INTR_FTFIE, true);
+    dma_->set_interrupt_enable(channel, dma::Interrupt_Type::INTR_ERRIE, true);
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channel));
+    if (wait_for_tc_) {
+        NVIC_EnableIRQ(USART_irqNumber[static_cast<int>(usart_.base_index_)]);
+    }
+
+    usart_.send_data_dma(true);
+
+    return USART_Error_Type::OK;
+}
+
+void DMA_Transmitter::end() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    dma_->set_channel_enable(get_dma_channel(), false);
+    dma_->clear_flags(dma::channel_all_flags_mask(get_dma_channel()));
+    usart_.set_interrupt_enable(Interrupt_Type::INTR_TCIE, false);
+    usart_.send_data_dma(false);
+    busy_ = false;
+    dma_ = nullptr;
+}
+
+USART_Error_Type DMA_Transmitter::submit(std::span<const uint8_t> data, Release_Callback on_release) {
+    if (dma_ == nullptr) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+    if (data.empty() || (data.size() > MaximumTransferCount)) {
+        return USART_Error_Type::INVALID_SELECTION;
+    }
+
+    // Release callbacks resubmit from the DMA interrupt, so producers are
+    // serialised here. The interrupt starts queued entries while a burst is
+    // running, only an idle channel needs to be kicked from here.
+    cortex::Critical_Section section;
+    if (!queue_.push(Entry{data, on_release})) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+    if (!busy_) {
+        busy_ = true;
+        // Transfers started by DMA do not clear TC, do it before the burst
+        write_bit(usart_, USART_Regs::STAT0, static_cast<uint32_t>(STAT0_Bits::TC), Clear);
+        usart_.rs485_driver_enable();
+        start_entry(queue_.read_span()[0]);
+    }
+    return USART_Error_Type::OK;
+}
+
+void DMA_Transmitter::handle_dma_interrupt() {
+    if ((dma_ == nullptr) || queue_.empty()) {
+        return;
+    }
+    const dma::DMA_Channel channel = get_dma_channel();
+    const dma::DMA_Status_Snapshot status = dma_->get_interrupt_snapshot(1U << static_cast<uint32_t>(channel));
+    dma_->clear_flags(status.flags);
+
+    const bool error = status.test(channel, dma::Status_Flags::FLAG_ERRIF);
+    if (!error && !status.test(channel, dma::Status_Flags::FLAG_FTFIF)) {
+        return;
+    }
+    if (error) {
+        dma_errors_ = dma_errors_ + 1;
+    }
+
+    // Take the finished entry off the queue and start the next one before
+    // running the release callback, so the line stays busy
+    const Entry done = queue_.read_span()[0];
+    queue_.consume(1);
+
+    if (!queue_.empty()) {
+        start_entry(queue_.read_span()[0]);
+    } else if (wait_for_tc_) {
+        usart_.rs485_arm_release();
+        usart_.set_interrupt_enable(Interrupt_Type::INTR_TCIE, true);
+    } else {
+        finish_burst();
+    }
+
+    if (done.on_release) {
+        done.on_release(done.data, error ? USART_Error_Type::DMA_TRANSFER_ERRROR : USART_Error_Type::OK);
+    }
+}
+
+void DMA_Transmitter::handle_usart_interrupt() {
+    if (!wait_for_tc_) {
+        return;
+    }
+    const uint32_t stat0 = read_register<uint32_t>(usart_, USART_Regs::STAT0);
+    const uint32_t ctl0 = read_register<uint32_t>(usart_, USART_Regs::CTL0);
+
+    if ((ctl0 & bit_mask(CTL0_Bits::TCIE)) && (stat0 & bit_mask(STAT0_Bits::TC))) {
+        // Entries submitted while waiting for TC found the transmitter busy,
+        // otherwise the line is released before anything else
+        const bool more = !queue_.empty();
+        if (!more) {
+            usart_.rs485_driver_release();
+        }
+        usart_.set_interrupt_enable(Interrupt_Type::INTR_TCIE, false);
+        write_bit(usart_, USART_Regs::STAT0, static_cast<uint32_t>(STAT0_Bits::TC), Clear);
+        if (more) {
+            start_entry(queue_.read_span()[0]);
+        } else {
+            finish_burst();
+        }
+    }
+}
+
+void DMA_Transmitter::start_entry(const Entry& entry) {
+    const dma::DMA_Channel channel = get_dma_channel();
+    dma_->set_channel_enable(channel, false);
+    dma_->set_data_address(channel, dma::Data_Type::MEMORY_ADDRESS, reinterpret_cast<uint32_t>(entry.data.data()));
+    dma_->set_transfer_count(channel, static_cast<uint32_t>(entry.data.size()));
+    dma_->set_channel_enable(channel, true);
+}
+
+void DMA_Transmitter::finish_burst() {
+    busy_ = false;
+    if (idle_callback_) {
+        idle_callback_();
+    }
+}
+
+} // namespace usart
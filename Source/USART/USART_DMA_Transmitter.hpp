@@ -0,0 +1,84 @@
+// gd32f30x USART queued DMA transmitter in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "RingBuffer.hpp"
+#include "DMA.hpp"
+#include "USART.hpp"
+
+namespace usart {
+
+//
+// Zero-copy transmission of caller owned buffers. Buffers are queued and
+// sent back to back by DMA, the next one being programmed from the transfer
+// complete interrupt. Each buffer's release callback runs (in interrupt
+// context) once DMA no longer reads it, after the next buffer was started.
+//
+// When wait_for_tc is set the end of a burst is taken from the USART TC
+// interrupt instead of the DMA, which is only needed when the line has to
+// be turned around (half-duplex, RS-485). RS-485 mode on the USART forces
+// it and DE is driven around each burst. The USART and DMA interrupts must
+// then share the same preemption priority.
+//
+class DMA_Transmitter {
+public:
+    using Release_Callback = std::function<void(std::span<const uint8_t> data, USART_Error_Type status)>;
+    using Idle_Callback = std::function<void()>;
+
+    struct Entry {
+        std::span<const uint8_t> data;
+        Release_Callback on_release;
+    };
+
+    explicit DMA_Transmitter(USART& usart) : usart_(usart) {}
+
+    // Queue storage size must be a power of two
+    USART_Error_Type begin(std::span<Entry> queue_storage, bool wait_for_tc = false);
+    void end();
+
+    // Queue a buffer, it must stay valid until its release callback runs.
+    // Buffers are limited to 65535 bytes by CHXCNT. Safe from tasks and
+    // interrupts of any priority, release callbacks included.
+    USART_Error_Type submit(std::span<const uint8_t> data, Release_Callback on_release = nullptr);
+    void set_idle_callback(Idle_Callback callback) {
+        idle_callback_ = callback;
+    }
+
+    bool is_idle() const {
+        return !busy_;
+    }
+    size_t queued() const {
+        return queue_.size();
+    }
+    uint32_t get_dma_error_count() const {
+        return dma_errors_;
+    }
+    dma::DMA_Channel get_dma_channel() const {
+        return USART_dma_index[static_cast<int>(usart_.base_index_)].tx_channel;
+    }
+
+    // Call from the DMA channel IRQ handler of the TX channel
+    void handle_dma_interrupt();
+    // Call from the USARTx_IRQHandler when wait_for_tc is used
+    void handle_usart_interrupt();
+
+private:
+    USART& usart_;
+    dma::DMA* dma_ = nullptr;
+    Ring_Buffer<Entry> queue_;
+    Idle_Callback idle_callback_;
+    volatile bool busy_ = false;
+    volatile uint32_t dma_errors_ = 0;
+    bool wait_for_tc_ = false;
+
+    void start_entry(const Entry& entry);
+    void finish_burst();
+};
+
+} // namespace usart
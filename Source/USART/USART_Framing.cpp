@@ -0,0 +1,231 @@
+// gd32f30x USART COBS/SLIP packet framing in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <cstring>
+
+#include "ByteScan.hpp"
+#include "CORTEX.hpp"
+#include "CRC.hpp"
+#include "USART_Framing.hpp"
+
+namespace usart {
+
+constexpr uint8_t CobsDelimiter = 0x00;
+constexpr uint8_t CobsMaximumCode = 0xFF;
+constexpr uint8_t SlipEnd = 0xC0;
+constexpr uint8_t SlipEsc = 0xDB;
+constexpr uint8_t SlipEscEnd = 0xDC;
+constexpr uint8_t SlipEscEsc = 0xDD;
+
+//
+// There is one CRC unit and decoders run in receive interrupts while encoders
+// run in tasks, so the reset, feed and read are done with interrupts off.
+// That is one register write per payload word.
+//
+static uint32_t frame_crc(const uint8_t* data, size_t size) {
+    cortex::Critical_Section section;
+    CRC_DEVICE.ensure_clock_enabled();
+    CRC_DEVICE.reset_data();
+    CRC_DEVICE.calculate_byte_data(data, static_cast<uint32_t>(size));
+    // The zero padding hides trailing zero bytes, the length word does not
+    return CRC_DEVICE.calculate_data(static_cast<uint32_t>(size));
+}
+
+void Frame_Decoder::feed(std::span<uint8_t> data) {
+    const uint8_t delimiter = (format_ == Frame_Format::COBS) ? CobsDelimiter : SlipEnd;
+    size_t position = 0;
+
+    while (position < data.size()) {
+        const size_t end = position + find_byte(data.subspan(position), delimiter);
+        if (end == data.size()) {
+            // Frame continues in the next span
+            append(data.subspan(position));
+            return;
+        }
+
+        if ((assembly_length_ == 0) && !discarding_) {
+            process_frame(data.subspan(position, end - position));
+        } else {
+            append(data.subspan(position, end - position));
+            if (!discarding_) {
+                process_frame(assembly_.first(assembly_length_));
+            }
+            assembly_length_ = 0;
+            discarding_ = false;
+        }
+        position = end + 1;
+    }
+}
+
+void Frame_Decoder::reset() {
+    assembly_length_ = 0;
+    discarding_ = false;
+}
+
+void Frame_Decoder::append(std::span<const uint8_t> data) {
+    if (discarding_ || data.empty()) {
+        return;
+    }
+    if (data.size() > (assembly_.size() - assembly_length_)) {
+        // Skip the rest of this frame up to the next delimiter
+        counters_.overflows = counters_.overflows + 1;
+        assembly_length_ = 0;
+        discarding_ = true;
+        return;
+    }
+    std::memcpy(assembly_.data() + assembly_length_, data.data(), data.size());
+    assembly_length_ += data.size();
+}
+
+void Frame_Decoder::process_frame(std::span<uint8_t> frame) {
+    // Back to back delimiters (SLIP sends a leading END) are not frames
+    if (frame.empty()) {
+        return;
+    }
+    const int length = (format_ == Frame_Format::COBS) ? decode_cobs(frame) : decode_slip(frame);
+    if (length < 0) {
+        counters_.decode_errors = counters_.decode_errors + 1;
+        return;
+    }
+
+    size_t payload_length = static_cast<size_t>(length);
+    if (check_crc_) {
+        if (payload_length < FrameCrcSize) {
+            counters_.crc_errors = counters_.crc_errors + 1;
+            return;
+        }
+        payload_length -= FrameCrcSize;
+        uint32_t received;
+        std::memcpy(&received, frame.data() + payload_length, sizeof(received));
+        if (frame_crc(frame.data(), payload_length) != received) {
+            counters_.crc_errors = counters_.crc_errors + 1;
+            return;
+        }
+    }
+
+    counters_.frames = counters_.frames + 1;
+    if (callback_) {
+        callback_(frame.first(payload_length));
+    }
+}
+
+//
+// The decoded output never gets ahead of the input, so each block is moved
+// down with memmove and the frame is rewritten in place.
+//
+int Frame_Decoder::decode_cobs(std::span<uint8_t> frame) {
+    uint8_t* const data = frame.data();
+    const size_t size = frame.size();
+    size_t read = 0;
+    size_t write = 0;
+
+    while (read < size) {
+        const uint8_t code = data[read++];
+        if (code == CobsDelimiter) {
+            return -1;
+        }
+        const size_t length = code - 1U;
+        if (length > (size - read)) {
+            return -1;
+        }
+        std::memmove(data + write, data + read, length);
+        write += length;
+        read += length;
+        if ((code != CobsMaximumCode) && (read < size)) {
+            data[write++] = 0;
+        }
+    }
+    return static_cast<int>(write);
+}
+
+int Frame_Decoder::decode_slip(std::span<uint8_t> frame) {
+    uint8_t* const data = frame.data();
+    const size_t size = frame.size();
+
+    // Nothing moves until the first escape
+    size_t read = find_byte(frame, SlipEsc);
+    size_t write = read;
+
+    while (read < size) {
+        uint8_t value = data[read++];
+        if (value == SlipEsc) {
+            if (read == size) {
+                return -1;
+            }
+            const uint8_t escaped = data[read++];
+            if (escaped == SlipEscEnd) {
+                value = SlipEnd;
+            } else if (escaped == SlipEscEsc) {
+                value = SlipEsc;
+            } else {
+                return -1;
+            }
+        }
+        data[write++] = value;
+    }
+    return static_cast<int>(write);
+}
+
+size_t Frame_Encoder::encode(std::span<const uint8_t> payload, std::span<uint8_t> out) const {
+    uint8_t trailer[FrameCrcSize];
+    const size_t trailer_size = append_crc_ ? FrameCrcSize : 0;
+    if (append_crc_) {
+        const uint32_t crc = frame_crc(payload.data(), payload.size());
+        std::memcpy(trailer, &crc, sizeof(trailer));
+    }
+
+    const size_t total = payload.size() + trailer_size;
+    const size_t bound = (format_ == Frame_Format::COBS) ? total + (total / 254) + 2 : (total * 2) + 2;
+    if (out.size() < bound) {
+        return 0;
+    }
+    auto byte_at = [&](size_t index) -> uint8_t {
+        return (index < payload.size()) ? payload[index] : trailer[index - payload.size()];
+    };
+
+    uint8_t* const dest = out.data();
+    size_t write = 0;
+
+    if (format_ == Frame_Format::COBS) {
+        size_t code_index = write++;
+        uint8_t code = 1;
+
+        for (size_t i = 0; i < total; ++i) {
+            const uint8_t value = byte_at(i);
+            if (value == 0) {
+                dest[code_index] = code;
+                code_index = write++;
+                code = 1;
+                continue;
+            }
+            dest[write++] = value;
+            if (++code == CobsMaximumCode) {
+                dest[code_index] = code;
+                code_index = write++;
+                code = 1;
+            }
+        }
+        dest[code_index] = code;
+        dest[write++] = CobsDelimiter;
+    } else {
+        // A leading END flushes any line noise at the receiver
+        dest[write++] = SlipEnd;
+        for (size_t i = 0; i < total; ++i) {
+            const uint8_t value = byte_at(i);
+            if (value == SlipEnd) {
+                dest[write++] = SlipEsc;
+                dest[write++] = SlipEscEnd;
+            } else if (value == SlipEsc) {
+                dest[write++] = SlipEsc;
+                dest[write++] = SlipEscEsc;
+            } else {
+                dest[write++] = value;
+            }
+        }
+        dest[write++] = SlipEnd;
+    }
+    return write;
+}
+
+} // namespace usart
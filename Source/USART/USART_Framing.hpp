@@ -0,0 +1,93 @@
+// gd32f30x USART COBS/SLIP packet framing in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "USART.hpp"
+
+namespace usart {
+
+//
+// Packets are protected by a CRC-32 trailer computed with the CRC unit
+// (polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection). The
+// payload is fed as little endian words, the last one zero padded, followed
+// by the payload length as one more word so that trailing zero bytes count.
+// The result is appended little endian before the frame is encoded.
+//
+constexpr size_t FrameCrcSize = 4;
+
+//
+// Splits received spans into frames and decodes them in place. A frame that
+// lies entirely within one span (the common case with DMA idle reports) is
+// decoded where it is without a copy. Only frames split across spans, e.g.
+// by the circular buffer wrapping, are gathered in the assembly buffer.
+//
+// The frame callback gets the payload without the CRC trailer. It runs in
+// the caller's context, usually the DMA_Receiver callback, and the payload
+// is only valid until it returns.
+//
+class Frame_Decoder {
+public:
+    using Frame_Callback = std::function<void(std::span<uint8_t> payload)>;
+
+    Frame_Decoder(Frame_Format format, std::span<uint8_t> assembly_buffer, Frame_Callback callback, bool check_crc = true)
+        : format_(format), assembly_(assembly_buffer), callback_(callback), check_crc_(check_crc) {}
+
+    // Data is decoded in place and must be writable
+    void feed(std::span<uint8_t> data);
+    // Drop a partially assembled frame, e.g. after a line error
+    void reset();
+
+    Frame_Counters get_counters() const {
+        return counters_;
+    }
+    void clear_counters() {
+        counters_ = {};
+    }
+
+    // Decode one frame (delimiters excluded) in place, returns the decoded
+    // length or -1 when the encoding is invalid
+    static int decode_cobs(std::span<uint8_t> frame);
+    static int decode_slip(std::span<uint8_t> frame);
+
+private:
+    Frame_Format format_;
+    std::span<uint8_t> assembly_;
+    Frame_Callback callback_;
+    bool check_crc_;
+    size_t assembly_length_ = 0;
+    bool discarding_ = false;
+    Frame_Counters counters_ = {};
+
+    void append(std::span<const uint8_t> data);
+    void process_frame(std::span<uint8_t> frame);
+};
+
+//
+// Encodes payload plus CRC trailer straight into a transmit buffer, which
+// can then be handed to DMA_Transmitter::submit() without another copy.
+//
+class Frame_Encoder {
+public:
+    explicit Frame_Encoder(Frame_Format format, bool append_crc = true) : format_(format), append_crc_(append_crc) {}
+
+    // Returns the encoded length including delimiters, 0 if out is too small
+    size_t encode(std::span<const uint8_t> payload, std::span<uint8_t> out) const;
+
+    // Worst case encoded size, for sizing transmit buffers
+    static constexpr size_t max_encoded_size(Frame_Format format, size_t payload_size) {
+        const size_t raw = payload_size + FrameCrcSize;
+        return (format == Frame_Format::COBS) ? raw + (raw / 254) + 2 : (raw * 2) + 2;
+    }
+
+private:
+    Frame_Format format_;
+    bool append_crc_;
+};
+
+} // namespace usart
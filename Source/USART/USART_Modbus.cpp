@@ -0,0 +1,220 @@
+// gd32f30x USART Modbus RTU engine in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <algorithm>
+#include <cstring>
+
+#include "USART_Modbus.hpp"
+
+namespace usart {
+
+// Address, function code and CRC
+constexpr size_t MinimumFrameSize = 4;
+constexpr size_t CrcSize = 2;
+
+USART_Error_Type Modbus_RTU::begin(Modbus_Role role, uint8_t address) {
+    // The receiver timeout is only implemented on USART0-2
+    if ((usart_.base_index_ == USART_Base::UART3_BASE) || (usart_.base_index_ == USART_Base::UART4_BASE)) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+    // Not valid until init() or set_baudrate() has programmed a divider
+    const Baud_Result baud = usart_.get_baud_result();
+    if (!baud.valid || (baud.achieved == 0)) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+
+    role_ = role;
+    address_ = address;
+    timing_ = modbus::timing(baud.achieved);
+    frame_length_ = 0;
+    frame_overflow_ = false;
+    tx_length_ = 0;
+    expect_echo_ = false;
+    request_pending_ = false;
+    crc_errors_ = 0;
+    frame_errors_ = 0;
+
+    USART_Error_Type result = transmitter_.begin(tx_queue_);
+    if (result != USART_Error_Type::OK) {
+        return result;
+    }
+    result = receiver_.begin(rx_dma_buffer_, [this](std::span<uint8_t> data, Receive_Event event) {
+        on_receive(data, event);
+    }, timing_.t35_bits);
+    if (result != USART_Error_Type::OK) {
+        transmitter_.end();
+    }
+    return result;
+}
+
+void Modbus_RTU::end() {
+    receiver_.end();
+    transmitter_.end();
+    request_pending_ = false;
+}
+
+Modbus_Status Modbus_RTU::send_request(uint8_t address, std::span<const uint8_t> pdu, Response_Callback callback,
+                                       uint32_t timeout_cycles) {
+    if ((role_ != Modbus_Role::MASTER) || pdu.empty() || (pdu.size() > modbus::MaximumPduSize)) {
+        return Modbus_Status::FRAME_ERROR;
+    }
+    if (request_pending_ || !transmitter_.is_idle()) {
+        return Modbus_Status::BUSY;
+    }
+
+    std::memcpy(tx_frame_.data() + 1, pdu.data(), pdu.size());
+    response_callback_ = callback;
+    request_address_ = address;
+    response_deadline_ = cortex::Deadline(timeout_cycles);
+    request_pending_ = true;
+    // Broadcasts are never answered, they complete once DMA has sent the frame
+    DMA_Transmitter::Release_Callback on_release = nullptr;
+    if (address == modbus::BroadcastAddress) {
+        on_release = [this](std::span<const uint8_t>, USART_Error_Type status) {
+            if (request_pending_) {
+                complete_request((status == USART_Error_Type::OK) ? Modbus_Status::OK : Modbus_Status::SEND_ERROR,
+                                 std::span<const uint8_t>());
+            }
+        };
+    }
+    if (send_frame(address, pdu.size(), on_release) != USART_Error_Type::OK) {
+        request_pending_ = false;
+        return Modbus_Status::SEND_ERROR;
+    }
+    return Modbus_Status::OK;
+}
+
+void Modbus_RTU::poll() {
+    if (!request_pending_ || !response_deadline_.expired()) {
+        return;
+    }
+    Response_Callback callback;
+    {
+        // The response may complete from the interrupt meanwhile
+        cortex::Critical_Section section;
+        if (!request_pending_) {
+            return;
+        }
+        request_pending_ = false;
+        callback = response_callback_;
+    }
+    if (callback) {
+        callback(Modbus_Status::TIMEOUT, std::span<const uint8_t>());
+    }
+}
+
+void Modbus_RTU::handle_usart_interrupt() {
+    receiver_.handle_usart_interrupt();
+    transmitter_.handle_usart_interrupt();
+}
+
+// Data arrives in DMA sized pieces, the receiver timeout closes the frame
+void Modbus_RTU::on_receive(std::span<uint8_t> data, Receive_Event event) {
+    if (!data.empty()) {
+        if (data.size() > (frame_.size() - frame_length_)) {
+            frame_overflow_ = true;
+        } else {
+            std::memcpy(frame_.data() + frame_length_, data.data(), data.size());
+            frame_length_ += data.size();
+        }
+    }
+    if (event == Receive_Event::RX_TIMEOUT) {
+        process_frame();
+        frame_length_ = 0;
+        frame_overflow_ = false;
+    } else if (event == Receive_Event::DMA_ERROR) {
+        // Bytes were lost, the frame would only fail its CRC
+        if (frame_length_ != 0) {
+            frame_errors_ = frame_errors_ + 1;
+        }
+        frame_length_ = 0;
+        frame_overflow_ = false;
+    }
+}
+
+void Modbus_RTU::process_frame() {
+    const size_t length = frame_length_;
+    if (length == 0) {
+        return;
+    }
+    if (frame_overflow_ || (length < MinimumFrameSize)) {
+        frame_errors_ = frame_errors_ + 1;
+        return;
+    }
+    // On a single wire (half-duplex) the first frame after sending is our
+    // own read back. Write responses may legitimately equal the request, so
+    // only that one frame is compared.
+    if (expect_echo_) {
+        expect_echo_ = false;
+        if ((length == tx_length_) && (std::memcmp(frame_.data(), tx_frame_.data(), length) == 0)) {
+            return;
+        }
+    }
+
+    // A pending broadcast only waits for its own transmission
+    const bool awaiting_response = request_pending_ && (request_address_ != modbus::BroadcastAddress);
+    const uint16_t received = static_cast<uint16_t>(frame_[length - 2] | (frame_[length - 1] << 8));
+    if (modbus::crc16(std::span<const uint8_t>(frame_.data(), length - CrcSize)) != received) {
+        crc_errors_ = crc_errors_ + 1;
+        if ((role_ == Modbus_Role::MASTER) && awaiting_response) {
+            complete_request(Modbus_Status::CRC_ERROR, std::span<const uint8_t>());
+        }
+        return;
+    }
+
+    const uint8_t address = frame_[0];
+    const std::span<const uint8_t> pdu(frame_.data() + 1, length - 1 - CrcSize);
+
+    if (role_ == Modbus_Role::MASTER) {
+        if (!awaiting_response) {
+            return;
+        }
+        if (address != request_address_) {
+            frame_errors_ = frame_errors_ + 1;
+            complete_request(Modbus_Status::FRAME_ERROR, std::span<const uint8_t>());
+            return;
+        }
+        complete_request(Modbus_Status::OK, pdu);
+        return;
+    }
+
+    if ((address != address_) && (address != modbus::BroadcastAddress)) {
+        return;
+    }
+    if (!request_handler_ || !transmitter_.is_idle()) {
+        return;
+    }
+    const size_t response_length = request_handler_(address, pdu,
+                                                     std::span<uint8_t>(tx_frame_.data() + 1, modbus::MaximumPduSize));
+    if ((response_length != 0) && (address != modbus::BroadcastAddress)) {
+        // Nobody to report to here, the master times out on a response that never left
+        send_frame(address_, std::min(response_length, modbus::MaximumPduSize));
+    }
+}
+
+// The PDU is already in place after the address byte
+USART_Error_Type Modbus_RTU::send_frame(uint8_t address, size_t pdu_length, DMA_Transmitter::Release_Callback on_release) {
+    tx_frame_[0] = address;
+    const size_t crc_offset = 1 + pdu_length;
+    const uint16_t crc = modbus::crc16(std::span<const uint8_t>(tx_frame_.data(), crc_offset));
+    tx_frame_[crc_offset] = static_cast<uint8_t>(crc & 0xFFU);
+    tx_frame_[crc_offset + 1] = static_cast<uint8_t>(crc >> 8);
+    tx_length_ = crc_offset + CrcSize;
+    expect_echo_ = (read_register<uint32_t>(usart_, USART_Regs::CTL2) & bit_mask(CTL2_Bits::HDEN)) != 0;
+
+    const USART_Error_Type result = transmitter_.submit(std::span<const uint8_t>(tx_frame_.data(), tx_length_), on_release);
+    if (result != USART_Error_Type::OK) {
+        expect_echo_ = false;
+    }
+    return result;
+}
+
+void Modbus_RTU::complete_request(Modbus_Status status, std::span<const uint8_t> pdu) {
+    request_pending_ = false;
+    if (response_callback_) {
+        response_callback_(status, pdu);
+    }
+}
+
+} // namespace usart
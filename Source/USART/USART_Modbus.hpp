@@ -0,0 +1,158 @@
+// gd32f30x USART Modbus RTU engine in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "USART_DMA_Receiver.hpp"
+#include "USART_DMA_Transmitter.hpp"
+
+namespace usart {
+
+namespace modbus {
+
+constexpr size_t MaximumFrameSize = 256;
+constexpr size_t MaximumPduSize = MaximumFrameSize - 3;
+constexpr uint8_t BroadcastAddress = 0;
+
+// CRC-16/MODBUS (reflected 0x8005, initial 0xFFFF), table built at compile time
+constexpr std::array<uint16_t, 256> make_crc16_table() {
+    std::array<uint16_t, 256> table = {};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint16_t crc = static_cast<uint16_t>(i);
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1U) ? static_cast<uint16_t>((crc >> 1) ^ 0xA001U) : static_cast<uint16_t>(crc >> 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint16_t, 256> Crc16Table = make_crc16_table();
+
+constexpr uint16_t crc16(std::span<const uint8_t> data, uint16_t crc = 0xFFFF) {
+    for (const uint8_t value : data) {
+        crc = static_cast<uint16_t>((crc >> 8) ^ Crc16Table[(crc ^ value) & 0xFFU]);
+    }
+    return crc;
+}
+
+static_assert(crc16(std::array<uint8_t, 9>{'1', '2', '3', '4', '5', '6', '7', '8', '9'}) == 0x4B37);
+
+// Inter-character (1.5T) and inter-frame (3.5T) silence, in bit times as
+// used by the RT register. Above 19200 baud the spec fixes them to 750us
+// and 1750us.
+struct Timing {
+    uint32_t t15_bits;
+    uint32_t t35_bits;
+};
+
+constexpr Timing timing(uint32_t baudrate, uint32_t bits_per_character = 11) {
+    if (baudrate > 19200) {
+        return Timing{
+            static_cast<uint32_t>((750ULL * baudrate + 999999) / 1000000),
+            static_cast<uint32_t>((1750ULL * baudrate + 999999) / 1000000),
+        };
+    }
+    return Timing{(bits_per_character * 3 + 1) / 2, (bits_per_character * 7 + 1) / 2};
+}
+
+} // namespace modbus
+
+//
+// Modbus RTU over DMA reception with the hardware receiver timeout (RT) set
+// to 3.5 character times, so the end of every frame costs one interrupt and
+// no per-byte timer is needed. Only USART0-2 implement RT.
+//
+// The 1.5T inter-character limit cannot be checked by the hardware; frames
+// with such gaps are accepted if their CRC is valid, as most stacks do.
+//
+// Responses are built in an internal buffer and sent with DMA_Transmitter.
+// With RS-485 mode enabled on the USART, DE is handled around each frame.
+// Callbacks run in interrupt context. The application forwards the USART
+// and both DMA channel interrupts, which must share one priority.
+//
+class Modbus_RTU {
+public:
+    // Slave: fill response_pdu and return its length, 0 sends nothing
+    using Request_Handler = std::function<size_t(uint8_t address, std::span<const uint8_t> request_pdu, std::span<uint8_t> response_pdu)>;
+    // Master: response PDU is empty unless status is OK
+    using Response_Callback = std::function<void(Modbus_Status status, std::span<const uint8_t> response_pdu)>;
+
+    explicit Modbus_RTU(USART& usart) : usart_(usart), receiver_(usart), transmitter_(usart) {}
+
+    // The USART must be configured first, the timing is taken from the rate
+    // its divider achieves. address is the slave's own address, ignored by a
+    // master.
+    USART_Error_Type begin(Modbus_Role role, uint8_t address = 0);
+    void end();
+
+    void set_request_handler(Request_Handler handler) {
+        request_handler_ = handler;
+    }
+    // Master only. The response deadline is in core cycles. A broadcast
+    // completes with OK once its frame has been sent, or SEND_ERROR.
+    Modbus_Status send_request(uint8_t address, std::span<const uint8_t> pdu, Response_Callback callback,
+                               uint32_t timeout_cycles);
+    // Master only, call periodically to expire requests without a response
+    void poll();
+
+    bool is_busy() const {
+        return request_pending_;
+    }
+    uint32_t get_crc_error_count() const {
+        return crc_errors_;
+    }
+    uint32_t get_frame_error_count() const {
+        return frame_errors_;
+    }
+    modbus::Timing get_timing() const {
+        return timing_;
+    }
+
+    // Interrupt forwarding
+    void handle_usart_interrupt();
+    void handle_rx_dma_interrupt() {
+        receiver_.handle_dma_interrupt();
+    }
+    void handle_tx_dma_interrupt() {
+        transmitter_.handle_dma_interrupt();
+    }
+
+private:
+    USART& usart_;
+    DMA_Receiver receiver_;
+    DMA_Transmitter transmitter_;
+    std::array<uint8_t, modbus::MaximumFrameSize * 2> rx_dma_buffer_ = {};
+    std::array<uint8_t, modbus::MaximumFrameSize> frame_ = {};
+    std::array<uint8_t, modbus::MaximumFrameSize> tx_frame_ = {};
+    std::array<DMA_Transmitter::Entry, 2> tx_queue_ = {};
+    size_t frame_length_ = 0;
+    size_t tx_length_ = 0;
+    bool frame_overflow_ = false;
+    bool expect_echo_ = false;
+
+    Modbus_Role role_ = Modbus_Role::SLAVE;
+    uint8_t address_ = 0;
+    modbus::Timing timing_ = {};
+    Request_Handler request_handler_;
+    Response_Callback response_callback_;
+    volatile bool request_pending_ = false;
+    uint8_t request_address_ = 0;
+    cortex::Deadline response_deadline_{cortex::Deadline::Infinite};
+    volatile uint32_t crc_errors_ = 0;
+    volatile uint32_t frame_errors_ = 0;
+
+    void on_receive(std::span<uint8_t> data, Receive_Event event);
+    void process_frame();
+    USART_Error_Type send_frame(uint8_t address, size_t pdu_length, DMA_Transmitter::Release_Callback on_release = nullptr);
+    void complete_request(Modbus_Status status, std::span<const uint8_t> pdu);
+};
+
+} // namespace usart
@@ -0,0 +1,132 @@
+// gd32f30x USART multi-drop addressing in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "USART_Multidrop.hpp"
+
+namespace usart {
+
+// The hardware compares the low four bits of an address mark with ADDR
+constexpr uint8_t HardwareAddressMask = 0x0F;
+
+USART_Error_Type Multidrop::begin(uint8_t address, std::span<uint8_t> buffer, Frame_Callback callback) {
+    const uint32_t ctl0 = read_register<uint32_t>(usart_, USART_Regs::CTL0);
+    if (((ctl0 & bit_mask(CTL0_Bits::WL)) == 0) || ((ctl0 & bit_mask(CTL0_Bits::PCEN)) != 0)) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+    if (buffer.empty()) {
+        return USART_Error_Type::INVALID_SELECTION;
+    }
+
+    address_ = address;
+    buffer_ = buffer;
+    callback_ = callback;
+    length_ = 0;
+    in_frame_ = false;
+    frames_ = 0;
+    alias_wakeups_ = 0;
+    overflows_ = 0;
+
+    usart_.set_wakeup_address(address & HardwareAddressMask);
+    usart_.set_mute_mode_wakeup(Wakeup_Mode::WM_ADDR);
+    write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::RBNEIE), Set,
+               static_cast<uint32_t>(CTL0_Bits::IDLEIE), Set);
+    NVIC_EnableIRQ(USART_irqNumber[static_cast<int>(usart_.base_index_)]);
+    usart_.mute_mode_enable(true);
+
+    return USART_Error_Type::OK;
+}
+
+void Multidrop::end() {
+    write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::RBNEIE), Clear,
+               static_cast<uint32_t>(CTL0_Bits::IDLEIE), Clear);
+    usart_.mute_mode_enable(false);
+    in_frame_ = false;
+}
+
+USART_Error_Type Multidrop::send_frame(uint8_t address, std::span<const uint8_t> data, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    // Let the previous frame finish, then clearing and setting TEN queues an
+    // idle character ahead of the address mark
+    while (!usart_.get_flag(Status_Flags::FLAG_TC)) {
+        if (deadline.expired()) {
+            return USART_Error_Type::TIMEOUT;
+        }
+    }
+    write_bit(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TEN), Clear);
+    write_bit(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TEN), Set);
+
+    if (!send_word(address_word(address), deadline)) {
+        return USART_Error_Type::TIMEOUT;
+    }
+    for (const uint8_t value : data) {
+        if (!send_word(value, deadline)) {
+            return USART_Error_Type::TIMEOUT;
+        }
+    }
+    return USART_Error_Type::OK;
+}
+
+bool Multidrop::send_word(uint16_t word, const cortex::Deadline& deadline) {
+    while (!usart_.get_flag(Status_Flags::FLAG_TBE)) {
+        if (deadline.expired()) {
+            return false;
+        }
+    }
+    usart_.send_data(word);
+    return true;
+}
+
+//
+// Only reached while awake: the address mark that woke the receiver, the
+// data that follows, and the idle line after it. An address mark for a
+// different node with the same low bits means the current frame is over.
+//
+void Multidrop::handle_interrupt() {
+    const uint32_t stat = read_register<uint32_t>(usart_, USART_Regs::STAT0);
+
+    if ((stat & (bit_mask(STAT0_Bits::RBNE) | bit_mask(STAT0_Bits::IDLEF))) == 0) {
+        return;
+    }
+    // Clears RBNE, IDLEF and the error flags together with the STAT0 read
+    const uint16_t word = usart_.receive_data();
+
+    if ((stat & bit_mask(STAT0_Bits::RBNE)) != 0) {
+        if ((word & AddressMark) != 0) {
+            finish_frame();
+            if (static_cast<uint8_t>(word) == address_) {
+                in_frame_ = true;
+                length_ = 0;
+            } else {
+                alias_wakeups_ = alias_wakeups_ + 1;
+                usart_.mute_mode_enable(true);
+                return;
+            }
+        } else if (in_frame_) {
+            if (length_ < buffer_.size()) {
+                buffer_[length_++] = static_cast<uint8_t>(word);
+            } else {
+                overflows_ = overflows_ + 1;
+            }
+        }
+    }
+
+    if ((stat & bit_mask(STAT0_Bits::IDLEF)) != 0) {
+        finish_frame();
+        usart_.mute_mode_enable(true);
+    }
+}
+
+void Multidrop::finish_frame() {
+    if (!in_frame_) {
+        return;
+    }
+    in_frame_ = false;
+    frames_ = frames_ + 1;
+    if (callback_) {
+        callback_(address_, buffer_.first(length_));
+    }
+}
+
+} // namespace usart
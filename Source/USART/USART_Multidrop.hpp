@@ -0,0 +1,80 @@
+// gd32f30x USART multi-drop addressing in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "USART.hpp"
+
+namespace usart {
+
+//
+// Multi-drop bus with 9-bit words: a word with bit 8 set is an address
+// mark, the 8 bits below carry the node address. The receiver stays in mute
+// mode and the hardware only wakes it for address marks whose low four
+// bits match ADDR, so traffic for other nodes costs no CPU time at all.
+// Nodes whose address differs only in the upper bits wake up too, check
+// the full address and go back to mute.
+//
+// A frame ends when the line goes idle or the next address mark arrives.
+// send_frame() always precedes the address with an idle character so
+// receivers see the end of the previous frame.
+//
+// The USART must be configured with WL_9BITS and no parity. The
+// application forwards its USARTx_IRQHandler to handle_interrupt().
+//
+class Multidrop {
+public:
+    using Frame_Callback = std::function<void(uint8_t address, std::span<const uint8_t> data)>;
+
+    static constexpr uint16_t AddressMark = 0x100;
+
+    explicit Multidrop(USART& usart) : usart_(usart) {}
+
+    // Node side, frames for address are collected in buffer and reported
+    USART_Error_Type begin(uint8_t address, std::span<uint8_t> buffer, Frame_Callback callback);
+    void end();
+
+    // Master side, polled transmit of address mark plus data
+    USART_Error_Type send_frame(uint8_t address, std::span<const uint8_t> data,
+                                uint32_t timeout_cycles = cortex::Deadline::Infinite);
+    // Word to place in a 16-bit DMA buffer to mark an address
+    static constexpr uint16_t address_word(uint8_t address) {
+        return static_cast<uint16_t>(AddressMark | address);
+    }
+
+    // Frames delivered, and wake ups for an alias address that were muted again
+    uint32_t get_frame_count() const {
+        return frames_;
+    }
+    uint32_t get_alias_wakeup_count() const {
+        return alias_wakeups_;
+    }
+    uint32_t get_overflow_count() const {
+        return overflows_;
+    }
+
+    // Call from the USARTx_IRQHandler
+    void handle_interrupt();
+
+private:
+    USART& usart_;
+    std::span<uint8_t> buffer_;
+    Frame_Callback callback_;
+    uint8_t address_ = 0;
+    size_t length_ = 0;
+    bool in_frame_ = false;
+    volatile uint32_t frames_ = 0;
+    volatile uint32_t alias_wakeups_ = 0;
+    volatile uint32_t overflows_ = 0;
+
+    void finish_frame();
+    bool send_word(uint16_t word, const cortex::Deadline& deadline);
+};
+
+} // namespace usart
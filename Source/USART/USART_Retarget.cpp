@@ -0,0 +1,251 @@
+// gd32f30x USART buffered printf/log retarget in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+#include "CORTEX.hpp"
+#include "USART_Retarget.hpp"
+
+namespace usart {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+// Fallback buffer for print() when the free space wraps around the ring end
+constexpr size_t PrintScratchSize = 128;
+
+USART_Error_Type Retarget::begin(std::span<uint8_t> storage, Drain_Method method, Overflow_Policy policy) {
+    if (!ring_.attach(storage)) {
+        return USART_Error_Type::INITIALIZATION_FAILED;
+    }
+    method_ = method;
+    policy_ = policy;
+    draining_ = false;
+    in_flight_ = 0;
+    dropped_ = 0;
+
+    if (method_ == Drain_Method::DRAIN_DMA) {
+        const USART_DMA_Channels& channels = USART_dma_index[static_cast<int>(usart_.base_index_)];
+        if (!channels.available) {
+            return USART_Error_Type::INVALID_OPERATION;
+        }
+        auto dma_result = dma::DMA::get_instance(channels.dma_base);
+        if (dma_result.error() != dma::DMA_Error_Type::OK) {
+            return USART_Error_Type::INITIALIZATION_FAILED;
+        }
+        dma_ = &dma_result.value();
+
+        const dma::DMA_Channel channel = channels.tx_channel;
+        dma_->reset(channel);
+        dma::DMA_Config tx_config = {
+            .peripheral_address = reinterpret_cast<uint32_t>(usart_.reg_address(USART_Regs::DATA)),
+            .peripheral_bit_width = dma::Bit_Width::WIDTH_8BIT,
+            .memory_address = 0,
+            .memory_bit_width = dma::Bit_Width::WIDTH_8BIT,
+            .count = 0,
+            .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+            .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+            .channel_priority = dma::Channel_Priority::LOW_PRIORITY,
+            .direction = dma::Transfer_Direction::M2P,
+        };
+        dma_->configure(channel, tx_config);
+        dma_->set_interrupt_enable(channel, dma::Interrupt_Type::INTR_FTFIE, true);
+        dma_->set_interrupt_enable(channel, dma::Interrupt_Type::INTR_ERRIE, true);
+        NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channel));
+        usart_.send_data_dma(true);
+    } else {
+        write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TBEIE), Clear,
+                   static_cast<uint32_t>(CTL0_Bits::TCIE), Clear);
+        NVIC_EnableIRQ(USART_irqNumber[static_cast<int>(usart_.base_index_)]);
+    }
+
+    return USART_Error_Type::OK;
+}
+
+size_t Retarget::write(std::span<const uint8_t> data) {
+    if (!ring_.is_attached()) {
+        return 0;
+    }
+    size_t written = 0;
+
+    while (true) {
+        written += ring_.write(data.subspan(written));
+        kick();
+        if (written == data.size()) {
+            break;
+        }
+        if ((policy_ != Overflow_Policy::BLOCK) || !can_block()) {
+            dropped_ = dropped_ + static_cast<uint32_t>(data.size() - written);
+            break;
+        }
+    }
+    return written;
+}
+
+int Retarget::put_char(int ch) {
+    const uint8_t data = static_cast<uint8_t>(ch);
+    return (write(std::span<const uint8_t>(&data, 1)) == 1) ? ch : EOF;
+}
+
+//
+// Formats straight into the free region of the ring when it is contiguous
+// and large enough, so the common case costs no copy at all. Otherwise, with
+// Overflow_Policy::BLOCK, it waits for the ring to drain and formats into the
+// whole of it; only text longer than the ring is cut. The non-blocking
+// policies go through a scratch buffer instead. Cut text counts as dropped,
+// like bytes the ring has no room for, and the return value is what was
+// queued.
+//
+int Retarget::print(const char* format, ...) {
+    if (!ring_.is_attached()) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, format);
+
+    std::span<uint8_t> dest = ring_.write_span();
+    va_list direct_args;
+    va_copy(direct_args, args);
+    const int length = vsnprintf(reinterpret_cast<char*>(dest.data()), dest.size(), format, direct_args);
+    va_end(direct_args);
+
+    if ((length >= 0) && (static_cast<size_t>(length) < dest.size())) {
+        ring_.commit(static_cast<size_t>(length));
+        kick();
+        va_end(args);
+        return length;
+    }
+
+    if ((length >= 0) && (policy_ == Overflow_Policy::BLOCK) && can_block()) {
+        // With the drain stopped the ring is empty and can start over at 0
+        while (draining_) {}
+        ring_.clear();
+        dest = ring_.write_span();
+        const int ring_length = vsnprintf(reinterpret_cast<char*>(dest.data()), dest.size(), format, args);
+        va_end(args);
+        if (ring_length < 0) {
+            return ring_length;
+        }
+        const size_t count = std::min(static_cast<size_t>(ring_length), dest.size() - 1);
+        if (count < static_cast<size_t>(ring_length)) {
+            dropped_ = dropped_ + static_cast<uint32_t>(static_cast<size_t>(ring_length) - count);
+        }
+        ring_.commit(count);
+        kick();
+        return static_cast<int>(count);
+    }
+
+    char scratch[PrintScratchSize];
+    const int scratch_length = vsnprintf(scratch, sizeof(scratch), format, args);
+    va_end(args);
+    if (scratch_length < 0) {
+        return scratch_length;
+    }
+    const size_t count = std::min(static_cast<size_t>(scratch_length), sizeof(scratch) - 1);
+    if (count < static_cast<size_t>(scratch_length)) {
+        dropped_ = dropped_ + static_cast<uint32_t>(static_cast<size_t>(scratch_length) - count);
+    }
+    return static_cast<int>(write(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(scratch), count)));
+}
+
+//
+// Stops the background drain where it is and sends whatever is left by
+// polling TBE. Bytes DMA already moved to the data register are accounted
+// for from CHXCNT so nothing is sent twice.
+//
+void Retarget::panic_flush() {
+    if (!ring_.is_attached()) {
+        return;
+    }
+    cortex::Critical_Section section;
+
+    if ((method_ == Drain_Method::DRAIN_DMA) && (dma_ != nullptr)) {
+        const dma::DMA_Channel channel = USART_dma_index[static_cast<int>(usart_.base_index_)].tx_channel;
+        if (draining_) {
+            dma_->set_channel_enable(channel, false);
+            ring_.consume(in_flight_ - dma_->get_transfer_count(channel));
+        }
+        dma_->clear_flags(dma::channel_all_flags_mask(channel));
+    } else {
+        write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TBEIE), Clear,
+                   static_cast<uint32_t>(CTL0_Bits::TCIE), Clear);
+    }
+    in_flight_ = 0;
+
+    uint8_t data;
+    while (ring_.pop(data)) {
+        while (!usart_.get_flag(Status_Flags::FLAG_TBE)) {}
+        usart_.send_data(data);
+    }
+    while (!usart_.get_flag(Status_Flags::FLAG_TC)) {}
+    draining_ = false;
+}
+
+void Retarget::handle_dma_interrupt() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    const dma::DMA_Channel channel = USART_dma_index[static_cast<int>(usart_.base_index_)].tx_channel;
+    const dma::DMA_Status_Snapshot status = dma_->get_interrupt_snapshot(1U << static_cast<uint32_t>(channel));
+    dma_->clear_flags(status.flags);
+
+    if (!status.test(channel, dma::Status_Flags::FLAG_FTFIF) && !status.test(channel, dma::Status_Flags::FLAG_ERRIF)) {
+        return;
+    }
+    // A failed chunk is dropped rather than retried, the console must not stall
+    ring_.consume(in_flight_);
+    in_flight_ = 0;
+    if (!ring_.empty()) {
+        start_dma_chunk();
+    } else {
+        draining_ = false;
+    }
+}
+
+void Retarget::handle_usart_interrupt() {
+    const uint32_t stat = read_register<uint32_t>(usart_, USART_Regs::STAT0);
+    const uint32_t ctl0 = read_register<uint32_t>(usart_, USART_Regs::CTL0);
+
+    if ((ctl0 & bit_mask(CTL0_Bits::TBEIE)) && (stat & bit_mask(STAT0_Bits::TBE))) {
+        uint8_t data;
+        if (ring_.pop(data)) {
+            usart_.send_data(data);
+        } else {
+            write_bit(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TBEIE), Clear);
+            draining_ = false;
+        }
+    }
+}
+
+// Blocking on a full ring is only possible when the drain interrupt can run
+bool Retarget::can_block() const {
+    return (__get_IPSR() == 0) && (__get_PRIMASK() == 0);
+}
+
+void Retarget::kick() {
+    cortex::Critical_Section section;
+    if (draining_ || ring_.empty()) {
+        return;
+    }
+    draining_ = true;
+    if (method_ == Drain_Method::DRAIN_DMA) {
+        start_dma_chunk();
+    } else {
+        write_bit(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::TBEIE), Set);
+    }
+}
+
+// DMA reads the ring in place, one contiguous region at a time
+void Retarget::start_dma_chunk() {
+    const dma::DMA_Channel channel = USART_dma_index[static_cast<int>(usart_.base_index_)].tx_channel;
+    const std::span<const uint8_t> chunk = ring_.read_span();
+    in_flight_ = std::min(chunk.size(), MaximumTransferCount);
+
+    dma_->set_channel_enable(channel, false);
+    dma_->set_data_address(channel, dma::Data_Type::MEMORY_ADDRESS, reinterpret_cast<uint32_t>(chunk.data()));
+    dma_->set_transfer_count(channel, static_cast<uint32_t>(in_flight_));
+    dma_->set_channel_enable(channel, true);
+}
+
+} // namespace usart
@@ -0,0 +1,69 @@
+// gd32f30x USART buffered printf/log retarget in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "RingBuffer.hpp"
+#include "DMA.hpp"
+#include "USART.hpp"
+
+namespace usart {
+
+//
+// Console output that never waits on the line. Text is formatted straight
+// into a ring buffer and drained in the background, either by DMA reading
+// the ring in place or by the TBE interrupt. __io_putchar/_write hooks
+// should forward to put_char()/write().
+//
+// Output is expected from a single context (thread code, or interrupts
+// using Overflow_Policy::DROP). panic_flush() empties the ring with
+// polling and is safe to call from fault handlers.
+//
+class Retarget {
+public:
+    explicit Retarget(USART& usart) : usart_(usart) {}
+
+    // Ring storage size must be a power of two
+    USART_Error_Type begin(std::span<uint8_t> storage, Drain_Method method, Overflow_Policy policy);
+    void set_overflow_policy(Overflow_Policy policy) {
+        policy_ = policy;
+    }
+
+    size_t write(std::span<const uint8_t> data);
+    int put_char(int ch);
+    int print(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    // Synchronous flush with interrupts masked, for fatal error paths
+    void panic_flush();
+
+    // Bytes discarded because the ring was full, or cut from print() output
+    // longer than its fallback buffer (the whole ring under BLOCK)
+    uint32_t get_dropped_count() const {
+        return dropped_;
+    }
+
+    // Call from the DMA channel IRQ handler of the TX channel (DRAIN_DMA)
+    void handle_dma_interrupt();
+    // Call from the USARTx_IRQHandler (DRAIN_INTERRUPT)
+    void handle_usart_interrupt();
+
+private:
+    USART& usart_;
+    dma::DMA* dma_ = nullptr;
+    Ring_Buffer<uint8_t> ring_;
+    Drain_Method method_ = Drain_Method::DRAIN_INTERRUPT;
+    Overflow_Policy policy_ = Overflow_Policy::DROP;
+    volatile bool draining_ = false;
+    volatile size_t in_flight_ = 0;
+    volatile uint32_t dropped_ = 0;
+
+    bool can_block() const;
+    void kick();
+    void start_dma_chunk();
+};
+
+} // namespace usart
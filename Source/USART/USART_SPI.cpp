@@ -0,0 +1,198 @@
+// gd32f30x USART synchronous mode SPI master in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#include "USART_SPI.hpp"
+
+namespace usart {
+
+constexpr size_t MaximumTransferCount = 0xFFFF;
+
+USART_Error_Type SPI_Over_USART::begin(const Sync_SPI_Config& config) {
+    const USART_DMA_Channels& channels = USART_dma_index[static_cast<int>(usart_.base_index_)];
+    // UART3 and UART4 have no CK output
+    if ((usart_.base_index_ == USART_Base::UART3_BASE) || (usart_.base_index_ == USART_Base::UART4_BASE) ||
+            !channels.available) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+
+    auto gpio_result = gpio::GPIO::get_instance(config.clock_pin.gpio_port);
+    if (gpio_result.error() != gpio::GPIO_Error_Type::OK) {
+        return USART_Error_Type::INITIALIZATION_FAILED;
+    }
+    gpio_result.value().init_pin(config.clock_pin.pin, config.clock_pin.mode, config.clock_pin.speed);
+
+    auto dma_result = dma::DMA::get_instance(channels.dma_base);
+    if (dma_result.error() != dma::DMA_Error_Type::OK) {
+        return USART_Error_Type::INITIALIZATION_FAILED;
+    }
+    dma_ = &dma_result.value();
+
+    const uint32_t pclk = usart_.get_pclk_frequency();
+    const uint32_t divider = clock_divider(pclk, config.clock_frequency);
+    clock_frequency_ = pclk / divider;
+
+    // Synchronous mode excludes LIN, smartcard, half-duplex and IrDA, and
+    // CK settings only take effect with the USART disabled
+    usart_.disable();
+    write_bits(usart_, USART_Regs::CTL0, static_cast<uint32_t>(CTL0_Bits::WL), Clear,
+               static_cast<uint32_t>(CTL0_Bits::PMEN), Clear,
+               static_cast<uint32_t>(CTL0_Bits::REN), Set,
+               static_cast<uint32_t>(CTL0_Bits::TEN), Set);
+    write_bits(usart_, USART_Regs::CTL1, static_cast<uint32_t>(CTL1_Bits::LMEN), Clear,
+               static_cast<uint32_t>(CTL1_Bits::STB), Clear,
+               static_cast<uint32_t>(CTL1_Bits::CLEN), static_cast<uint32_t>(Pulse_Length::EXT_PULSE_ENABLE),
+               static_cast<uint32_t>(CTL1_Bits::CPH), static_cast<uint32_t>(config.phase),
+               static_cast<uint32_t>(CTL1_Bits::CPL), static_cast<uint32_t>(config.polarity),
+               static_cast<uint32_t>(CTL1_Bits::CKEN), Set);
+    write_bits(usart_, USART_Regs::CTL2, static_cast<uint32_t>(CTL2_Bits::SCEN), Clear,
+               static_cast<uint32_t>(CTL2_Bits::HDEN), Clear,
+               static_cast<uint32_t>(CTL2_Bits::IREN), Clear);
+    usart_.set_msb(config.bit_order);
+    write_register<uint32_t>(usart_, USART_Regs::BAUD, divider);
+    usart_.enable();
+
+    dma::DMA_Config rx_config = {
+        .peripheral_address = reinterpret_cast<uint32_t>(usart_.reg_address(USART_Regs::DATA)),
+        .peripheral_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .memory_address = 0,
+        .memory_bit_width = dma::Bit_Width::WIDTH_8BIT,
+        .count = 0,
+        .peripheral_increase = dma::Increase_Mode::INCREASE_DISABLE,
+        .memory_increase = dma::Increase_Mode::INCREASE_ENABLE,
+        .channel_priority = dma::Channel_Priority::HIGH_PRIORITY,
+        .direction = dma::Transfer_Direction::P2M,
+    };
+    dma::DMA_Config tx_config = rx_config;
+    tx_config.channel_priority = dma::Channel_Priority::MEDIUM_PRIORITY;
+    tx_config.direction = dma::Transfer_Direction::M2P;
+
+    dma_->reset(channels.rx_channel);
+    dma_->configure(channels.rx_channel, rx_config);
+    dma_->set_interrupt_enable(channels.rx_channel, dma::Interrupt_Type::INTR_FTFIE, true);
+    dma_->set_interrupt_enable(channels.rx_channel, dma::Interrupt_Type::INTR_ERRIE, true);
+    dma_->reset(channels.tx_channel);
+    dma_->configure(channels.tx_channel, tx_config);
+    dma_->set_interrupt_enable(channels.tx_channel, dma::Interrupt_Type::INTR_ERRIE, true);
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channels.rx_channel));
+    NVIC_EnableIRQ(dma::get_irq_number(channels.dma_base, channels.tx_channel));
+
+    busy_ = false;
+    return USART_Error_Type::OK;
+}
+
+void SPI_Over_USART::end() {
+    if (dma_ == nullptr) {
+        return;
+    }
+    const USART_DMA_Channels& channels = USART_dma_index[static_cast<int>(usart_.base_index_)];
+    dma_->set_channel_enable(channels.rx_channel, false);
+    dma_->set_channel_enable(channels.tx_channel, false);
+    usart_.receive_data_dma(false);
+    usart_.send_data_dma(false);
+    usart_.set_synchronous_clock_enable(false);
+    busy_ = false;
+    dma_ = nullptr;
+}
+
+//
+// RX is armed before TX: the first clock edge comes from the first TX byte
+// and the RX channel must already be waiting for it.
+//
+USART_Error_Type SPI_Over_USART::transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx, Transfer_Callback callback) {
+    if (dma_ == nullptr) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+    const size_t length = tx.empty() ? rx.size() : tx.size();
+    if ((length == 0) || (length > MaximumTransferCount) || (!tx.empty() && !rx.empty() && (tx.size() != rx.size()))) {
+        return USART_Error_Type::INVALID_SELECTION;
+    }
+    if (busy_) {
+        return USART_Error_Type::INVALID_OPERATION;
+    }
+    busy_ = true;
+    status_ = USART_Error_Type::OK;
+    callback_ = callback;
+
+    const USART_DMA_Channels& channels = USART_dma_index[static_cast<int>(usart_.base_index_)];
+    const dma::DMA_Channel rx_channel = channels.rx_channel;
+    const dma::DMA_Channel tx_channel = channels.tx_channel;
+
+    // Drop a byte left over from polled use
+    read_register<uint32_t>(usart_, USART_Regs::STAT0);
+    read_register<uint32_t>(usart_, USART_Regs::DATA);
+    dma_->clear_flags(dma::channel_all_flags_mask(rx_channel) | dma::channel_all_flags_mask(tx_channel));
+
+    dma_->set_channel_enable(rx_channel, false);
+    dma_->set_data_address(rx_channel, dma::Data_Type::MEMORY_ADDRESS,
+                           reinterpret_cast<uint32_t>(rx.empty() ? &dummy_rx_ : rx.data()));
+    dma_->set_increase_mode_enable(rx_channel, dma::Data_Type::MEMORY_ADDRESS, !rx.empty());
+    dma_->set_transfer_count(rx_channel, static_cast<uint32_t>(length));
+
+    dma_->set_channel_enable(tx_channel, false);
+    dma_->set_data_address(tx_channel, dma::Data_Type::MEMORY_ADDRESS,
+                           reinterpret_cast<uint32_t>(tx.empty() ? &dummy_tx_ : tx.data()));
+    dma_->set_increase_mode_enable(tx_channel, dma::Data_Type::MEMORY_ADDRESS, !tx.empty());
+    dma_->set_transfer_count(tx_channel, static_cast<uint32_t>(length));
+
+    dma_->set_channel_enable(rx_channel, true);
+    usart_.receive_data_dma(true);
+    dma_->set_channel_enable(tx_channel, true);
+    usart_.send_data_dma(true);
+
+    return USART_Error_Type::OK;
+}
+
+USART_Error_Type SPI_Over_USART::transfer_blocking(std::span<const uint8_t> tx, std::span<uint8_t> rx, uint32_t timeout_cycles) {
+    const cortex::Deadline deadline(timeout_cycles);
+
+    USART_Error_Type result = transfer(tx, rx);
+    if (result != USART_Error_Type::OK) {
+        return result;
+    }
+    while (busy_) {
+        if (deadline.expired()) {
+            cortex::Critical_Section section;
+            if (busy_) {
+                finish(USART_Error_Type::TIMEOUT);
+            }
+            return USART_Error_Type::TIMEOUT;
+        }
+    }
+    return status_;
+}
+
+void SPI_Over_USART::handle_dma_interrupt() {
+    if ((dma_ == nullptr) || !busy_) {
+        return;
+    }
+    const USART_DMA_Channels& channels = USART_dma_index[static_cast<int>(usart_.base_index_)];
+    const uint32_t channel_mask = (1U << static_cast<uint32_t>(channels.rx_channel)) |
+                                  (1U << static_cast<uint32_t>(channels.tx_channel));
+    const dma::DMA_Status_Snapshot status = dma_->get_interrupt_snapshot(channel_mask);
+    dma_->clear_flags(status.flags);
+
+    if (status.test(channels.rx_channel, dma::Status_Flags::FLAG_ERRIF) ||
+            status.test(channels.tx_channel, dma::Status_Flags::FLAG_ERRIF)) {
+        finish(USART_Error_Type::DMA_TRANSFER_ERRROR);
+    } else if (status.test(channels.rx_channel, dma::Status_Flags::FLAG_FTFIF)) {
+        // The last byte received means the last clock has been sent
+        finish(USART_Error_Type::OK);
+    }
+}
+
+void SPI_Over_USART::finish(USART_Error_Type status) {
+    const USART_DMA_Channels& channels = USART_dma_index[static_cast<int>(usart_.base_index_)];
+    usart_.send_data_dma(false);
+    usart_.receive_data_dma(false);
+    dma_->set_channel_enable(channels.tx_channel, false);
+    dma_->set_channel_enable(channels.rx_channel, false);
+
+    status_ = status;
+    busy_ = false;
+    if (callback_) {
+        callback_(status);
+    }
+}
+
+} // namespace usart
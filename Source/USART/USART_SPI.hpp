@@ -0,0 +1,89 @@
+// gd32f30x USART synchronous mode SPI master in C++
+// Copyright (c) 2024 B. Mourit <bnmguy@gmail.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CORTEX.hpp"
+#include "DMA.hpp"
+#include "USART.hpp"
+
+namespace usart {
+
+//
+// SPI master built on the USART synchronous clock mode: TX is MOSI, RX is
+// MISO and CK is SCK. Every byte is clocked out with the last bit pulse
+// enabled, so all eight data bits get a clock edge. Chip select is up to
+// the caller. Only USART0-2 have a CK pin.
+//
+// Transfers are full duplex with both DMA channels; write-only and
+// read-only transfers use a one byte dummy on the unused side. Completion
+// comes from the RX channel, the application forwards both DMA channel
+// interrupts to handle_dma_interrupt().
+//
+class SPI_Over_USART {
+public:
+    using Transfer_Callback = std::function<void(USART_Error_Type status)>;
+
+    static constexpr uint8_t DummyByte = 0xFF;
+    // USARTDIV limits, the synchronous clock is at most PCLK / 16
+    static constexpr uint32_t MinimumDivider = 16;
+    static constexpr uint32_t MaximumDivider = 0xFFFF;
+
+    explicit SPI_Over_USART(USART& usart) : usart_(usart) {}
+
+    // Smallest divider whose clock does not exceed the requested one
+    static constexpr uint32_t clock_divider(uint32_t pclk, uint32_t clock_frequency) {
+        if (clock_frequency == 0) {
+            return MaximumDivider;
+        }
+        const uint32_t divider = (pclk + clock_frequency - 1) / clock_frequency;
+        return (divider < MinimumDivider) ? MinimumDivider : (divider > MaximumDivider) ? MaximumDivider : divider;
+    }
+    static constexpr uint32_t achieved_clock(uint32_t pclk, uint32_t clock_frequency) {
+        return pclk / clock_divider(pclk, clock_frequency);
+    }
+
+    // TX/RX pins must already be configured with USART::pins_configure()
+    USART_Error_Type begin(const Sync_SPI_Config& config);
+    void end();
+
+    // tx and rx must have the same size unless one of them is empty
+    USART_Error_Type transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx, Transfer_Callback callback = nullptr);
+    USART_Error_Type write(std::span<const uint8_t> tx, Transfer_Callback callback = nullptr) {
+        return transfer(tx, std::span<uint8_t>(), callback);
+    }
+    USART_Error_Type read(std::span<uint8_t> rx, Transfer_Callback callback = nullptr) {
+        return transfer(std::span<const uint8_t>(), rx, callback);
+    }
+    USART_Error_Type transfer_blocking(std::span<const uint8_t> tx, std::span<uint8_t> rx,
+                                       uint32_t timeout_cycles = cortex::Deadline::Infinite);
+
+    bool is_busy() const {
+        return busy_;
+    }
+    uint32_t get_clock_frequency() const {
+        return clock_frequency_;
+    }
+
+    // Call from the IRQ handlers of both the TX and RX DMA channels
+    void handle_dma_interrupt();
+
+private:
+    USART& usart_;
+    dma::DMA* dma_ = nullptr;
+    Transfer_Callback callback_;
+    volatile bool busy_ = false;
+    volatile USART_Error_Type status_ = USART_Error_Type::OK;
+    uint32_t clock_frequency_ = 0;
+    uint8_t dummy_tx_ = DummyByte;
+    uint8_t dummy_rx_ = 0;
+
+    void finish(USART_Error_Type status);
+};
+
+} // namespace usart
@@ -9,6 +9,7 @@
 
 #include "CONFIG.hpp"
 #include "RCU.hpp"
+#include "dma_config.hpp"
 
 namespace usart {
 
@@ -31,6 +32,14 @@ static constexpr uintptr_t USART_baseAddress[] = {
     0x40005000, // UART4
 };
 
+static constexpr IRQn_Type USART_irqNumber[] = {
+    USART0_IRQn,
+    USART1_IRQn,
+    USART2_IRQn,
+    UART3_IRQn,
+    UART4_IRQn,
+};
+
 
 ///////////////////////////// REGISTER OFFSETS /////////////////////////////
 
@@ -275,6 +284,43 @@ enum class USART_DMA_Config {
     DMA_DUAL,
 };
 
+enum class Receive_Event {
+    IDLE_LINE,      // IDLEF, the line went quiet after a frame
+    RX_TIMEOUT,     // RTF, receiver timeout threshold elapsed
+    HALF_TRANSFER,  // DMA HTF, first half of the circular buffer filled
+    FULL_TRANSFER,  // DMA FTF, buffer wrapped
+    DMA_ERROR,      // DMA ERRIF, bytes may be missing, reception restarts at the buffer start
+};
+
+enum class Frame_Format {
+    COBS,   // Consistent overhead byte stuffing, 0x00 delimited
+    SLIP,   // RFC 1055, 0xC0 delimited
+};
+
+enum class Modbus_Role {
+    MASTER,
+    SLAVE,
+};
+
+enum class Modbus_Status {
+    OK,
+    TIMEOUT,        // No response before the deadline
+    CRC_ERROR,
+    FRAME_ERROR,    // Too short, too long, or an unexpected slave address
+    BUSY,           // A request is still outstanding
+    SEND_ERROR,     // The frame could not be queued for transmission
+};
+
+enum class Drain_Method {
+    DRAIN_DMA,
+    DRAIN_INTERRUPT,
+};
+
+enum class Overflow_Policy {
+    DROP,   // Discard what does not fit
+    BLOCK,  // Wait for room, falls back to DROP in interrupt context
+};
+
 enum class USART_Error_Type {
     OK = 0,
     INVALID_USART,
@@ -287,6 +333,7 @@ enum class USART_Error_Type {
     FRAME_ERROR,
     DMA_TRANSFER_ERRROR,
     TIMEOUT,
+    BAUD_OUT_OF_TOLERANCE,
 };
 
 
@@ -335,6 +382,83 @@ struct USART_Pins {
     USART_Pin_Config tx_pin; // Pass the expected config for tx gpio pin setup
 };
 
+struct USART_DMA_Channels {
+    bool available;
+    dma::DMA_Base dma_base;
+    dma::DMA_Channel tx_channel;
+    dma::DMA_Channel rx_channel;
+};
+
+// UART4 has no DMA requests
+static const USART_DMA_Channels USART_dma_index[] = {
+    {true, dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL3, dma::DMA_Channel::CHANNEL4},
+    {true, dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL6, dma::DMA_Channel::CHANNEL5},
+    {true, dma::DMA_Base::DMA0_BASE, dma::DMA_Channel::CHANNEL1, dma::DMA_Channel::CHANNEL2},
+    {true, dma::DMA_Base::DMA1_BASE, dma::DMA_Channel::CHANNEL4, dma::DMA_Channel::CHANNEL2},
+    {false, dma::DMA_Base::DMA1_BASE, dma::DMA_Channel::CHANNEL0, dma::DMA_Channel::CHANNEL0},
+};
+
+struct USART_Error_Counters {
+    uint32_t overrun;       // ORERR, a byte arrived before the previous one was read
+    uint32_t framing;       // FERR, stop bit missing
+    uint32_t noise;         // NERR, noise detected during sampling
+    uint32_t parity;        // PERR
+    uint32_t rx_dropped;    // Received bytes discarded because the RX ring was full
+};
+
+struct Frame_Counters {
+    uint32_t frames;        // Frames delivered
+    uint32_t crc_errors;    // Trailer did not match the computed CRC
+    uint32_t decode_errors; // Invalid COBS code or SLIP escape
+    uint32_t overflows;     // Frames longer than the assembly buffer
+};
+
+// Decoded interrupt state, one bit per Interrupt_Flags value that is both
+// flagged and enabled. stat0/stat1 keep the raw registers for the rest.
+struct USART_Status_Snapshot {
+    uint32_t events;
+    uint32_t stat0;
+    uint32_t stat1;
+    uint16_t data;      // DATA, valid after USART::dispatch() when data_read is set
+    bool data_read;
+
+    bool test(Interrupt_Flags flag) const {
+        return (events & (1U << static_cast<uint32_t>(flag))) != 0;
+    }
+    bool any() const {
+        return events != 0;
+    }
+    bool has_errors() const {
+        constexpr uint32_t ErrorEvents = (1U << static_cast<uint32_t>(Interrupt_Flags::INTR_FLAG_CTL0_PERR)) |
+                                         (1U << static_cast<uint32_t>(Interrupt_Flags::INTR_FLAG_CTL0_ORERR)) |
+                                         (1U << static_cast<uint32_t>(Interrupt_Flags::INTR_FLAG_CTL2_ORERR)) |
+                                         (1U << static_cast<uint32_t>(Interrupt_Flags::INTR_FLAG_CTL2_NERR)) |
+                                         (1U << static_cast<uint32_t>(Interrupt_Flags::INTR_FLAG_CTL2_FERR));
+        return (events & ErrorEvents) != 0;
+    }
+};
+
+struct Sync_SPI_Config {
+    uint32_t clock_frequency;   // Requested SCK, the achieved rate is never higher
+    Clock_Polarity polarity;    // CPOL, idle level of CK
+    Clock_Phase phase;          // CPHA, FIRST_CLOCK samples on the leading edge
+    MSBF_Mode bit_order;
+    USART_Pin_Config clock_pin; // CK: USART0 PA8, USART1 PA4, USART2 PB12
+};
+
+struct RS485_Config {
+    gpio::GPIO_Base de_port;    // Driver enable (DE, or DE+/RE tied) pin
+    gpio::Pin_Number de_pin;
+    bool de_active_high;        // Level that turns the driver on
+    bool half_duplex;           // Single wire, HDEN
+};
+
+struct RS485_Statistics {
+    uint32_t transmissions;             // Bursts bracketed by DE
+    uint32_t last_turnaround_cycles;    // Estimated end of stop bit to DE release, core cycles
+    uint32_t max_turnaround_cycles;
+};
+
 struct USART_Config {
     USART_DMA_Config dma_pin_ops;   // DMA pin usage flag: off, RX pin, TX pin, or both pins
     uint32_t baudrate;              // Must never be 0
@@ -343,6 +467,47 @@ struct USART_Config {
     Stop_Bits stop_bits;
     MSBF_Mode msbf;
     Direction_Mode direction;
-};
+    uint32_t baud_tolerance_ppm = 0;    // init() refuses larger errors, 0 accepts any valid divider
+};
+
+struct Baud_Result {
+    uint32_t divider;   // BAUD register: INTDIV[15:4], FRADIV[3:0]
+    uint32_t achieved;  // Actual rate in baud
+    int32_t error_ppm;  // (achieved - requested) / requested
+    bool valid;         // Divider within 16x oversampling limits
+};
+
+///////////////////////////// BAUD RATE /////////////////////////////
+
+// 16x oversampling: BAUD = PCLK / baudrate in 12.4 fixed point, so the
+// integer and fractional dividers come out of one rounded division.
+// INTDIV must be at least 1, which caps the rate at PCLK / 16.
+constexpr uint32_t MinimumBaudDivider = 0x10;
+constexpr uint32_t MaximumBaudDivider = 0xFFFF;
+
+constexpr Baud_Result calculate_baud(uint32_t pclk, uint32_t baudrate) {
+    if ((pclk == 0) || (baudrate == 0)) {
+        return Baud_Result{0, 0, 0, false};
+    }
+    const uint32_t divider = static_cast<uint32_t>((static_cast<uint64_t>(pclk) + (baudrate / 2)) / baudrate);
+    if ((divider < MinimumBaudDivider) || (divider > MaximumBaudDivider)) {
+        return Baud_Result{divider, 0, 0, false};
+    }
+    const uint32_t achieved = static_cast<uint32_t>((static_cast<uint64_t>(pclk) + (divider / 2)) / divider);
+    // From the exact divider, the rounded achieved rate is off by up to 0.5 baud
+    const int64_t ideal = static_cast<int64_t>(baudrate) * divider;
+    const int64_t error_ppm = ((static_cast<int64_t>(pclk) - ideal) * 1000000) / ideal;
+    return Baud_Result{divider, achieved, static_cast<int32_t>(error_ppm), true};
+}
+
+constexpr bool baud_within_tolerance(const Baud_Result& result, uint32_t tolerance_ppm) {
+    const uint32_t error = static_cast<uint32_t>((result.error_ppm < 0) ? -result.error_ppm : result.error_ppm);
+    return result.valid && ((tolerance_ppm == 0) || (error <= tolerance_ppm));
+}
+
+static_assert(calculate_baud(120000000, 115200).divider == 1042);
+static_assert(calculate_baud(120000000, 4500000).valid);
+static_assert(!calculate_baud(60000000, 4500000).valid);
+static_assert(calculate_baud(72000000, 1100).error_ppm == -6);
 
 } // namespace usart